@@ -0,0 +1,92 @@
+#include "atomic_bucket.h"
+#include "bucket.h"
+#include "caching_memory_pool.h"
+#include "memory_pool.h"
+#include <array>
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <mutex>
+
+namespace {
+// Blocks each thread holds at once, as a burst of order nodes would
+constexpr std::size_t batch_size = 32;
+constexpr std::size_t node_size = 24;
+
+/**
+ * @brief Allocate and free `batch_size` nodes per iteration through @a pool.
+ */
+template<typename Pool>
+void
+run_batches(benchmark::State& state, Pool& pool)
+{
+    std::array<void*, batch_size> nodes{};
+    for (auto _ : state) {
+        for (void*& node : nodes)
+            node = pool.allocate(node_size);
+        for (void* node : nodes)
+            pool.deallocate(node, node_size);
+    }
+    state.SetItemsProcessed(state.iterations() * batch_size);
+}
+
+/**
+ * @brief A @a MemoryPool of plain buckets behind one mutex, the baseline
+ * for concurrent use.
+ */
+class LockedMemoryPool
+{
+  public:
+    void* allocate(std::size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock{ m_mutex };
+        return m_pool.allocate(bytes);
+    }
+    void deallocate(void* ptr, std::size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock{ m_mutex };
+        m_pool.deallocate(ptr, bytes);
+    }
+
+  private:
+    dev::MemoryPool<1> m_pool;
+    std::mutex m_mutex;
+};
+}
+
+template<typename Bucket>
+static void
+BM_Bucket_AllocateFree(benchmark::State& state)
+{
+    // Half full, so that scans start past a run of in-use words
+    Bucket bucket{ 32, 10000 };
+    for (std::size_t i = 0; i < 5000; ++i)
+        bucket.allocate(32);
+    run_batches(state, bucket);
+}
+BENCHMARK(BM_Bucket_AllocateFree<dev::Bucket>);
+BENCHMARK(BM_Bucket_AllocateFree<dev::AtomicBucket>);
+
+static void
+BM_MemoryPool_Locked(benchmark::State& state)
+{
+    static LockedMemoryPool pool;
+    run_batches(state, pool);
+}
+BENCHMARK(BM_MemoryPool_Locked)->ThreadRange(1, 16)->UseRealTime();
+
+static void
+BM_MemoryPool_ThreadCaches(benchmark::State& state)
+{
+    run_batches(state, dev::CachingMemoryPool<1>::instance());
+}
+BENCHMARK(BM_MemoryPool_ThreadCaches)->ThreadRange(1, 16)->UseRealTime();
+
+static void
+BM_MemoryPool_AtomicBuckets(benchmark::State& state)
+{
+    static dev::MemoryPool<2> pool;
+    run_batches(state, pool);
+}
+BENCHMARK(BM_MemoryPool_AtomicBuckets)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,326 @@
+#include "market_data_manager.h"
+#include "order_book.h"
+#include "order_flow.h"
+#include "order_type.h"
+#include <benchmark/benchmark.h>
+#include <format>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace dev;
+
+namespace {
+constexpr std::size_t flow_size = 1u << 16;
+
+// Twice the default mid price of the flow, so both sides fit
+constexpr std::size_t num_ticks = 1u << 11;
+
+// Expiry work done before each message of a flow with order lifetimes
+constexpr std::size_t expiry_budget = 64;
+
+/**
+ * @brief Applies flow messages to a set of books through @a Books, keeping
+ * the ids of the orders it rested so that cancels and modifies hit live
+ * orders. Ids of orders filled or expired since are dropped when they are
+ * drawn.
+ */
+template<typename Books>
+class FlowDriver
+{
+  public:
+    explicit FlowDriver(const OrderFlowConfig& config)
+      : m_books{ config }
+      , m_live_ids(config.num_symbols)
+      , m_order_lifetime{ config.order_lifetime }
+    {
+    }
+
+    void apply(const FlowMessage& message)
+    {
+        if (m_order_lifetime != 0)
+            m_books.expire_orders(message.arrival_time, expiry_budget);
+
+        std::vector<OrderId>& live_ids = m_live_ids[message.symbol_index];
+        switch (message.action) {
+            case FlowAction::ADD: {
+                OrderId order_id = m_books.add_order(OrderType::LIMIT,
+                                                     message.symbol_index,
+                                                     message.side,
+                                                     message.price,
+                                                     message.quantity);
+                if (m_books.order_exists(order_id)) {
+                    live_ids.push_back(order_id);
+                    if (m_order_lifetime != 0)
+                        m_books.schedule_expiry(order_id,
+                                                message.arrival_time + m_order_lifetime);
+                }
+                break;
+            }
+            case FlowAction::CANCEL:
+                if (OrderId* order_id = draw(live_ids, message.target)) {
+                    m_books.cancel_order(*order_id);
+                    remove(live_ids, order_id);
+                }
+                break;
+            case FlowAction::MODIFY:
+                if (OrderId* order_id = draw(live_ids, message.target)) {
+                    // Flow prices are on the message's side, keep the order's
+                    const Order& order = m_books.get_order(*order_id);
+                    Price new_price =
+                      order.side == message.side ? message.price : order.price;
+                    m_books.modify_order(*order_id, new_price, message.quantity);
+                    if (!m_books.order_exists(*order_id))
+                        remove(live_ids, order_id);
+                }
+                break;
+            case FlowAction::MARKET:
+                m_books.add_order(OrderType::MARKET,
+                                  message.symbol_index,
+                                  message.side,
+                                  0,
+                                  message.quantity);
+                break;
+        }
+    }
+
+  private:
+    Books m_books;
+    std::vector<std::vector<OrderId>> m_live_ids;
+    Timestamp m_order_lifetime;
+
+    /**
+     * @brief A live order picked by @a target, or nullptr if there is none.
+     */
+    OrderId* draw(std::vector<OrderId>& live_ids, uint64_t target)
+    {
+        while (!live_ids.empty()) {
+            OrderId* order_id = &live_ids[target % live_ids.size()];
+            if (m_books.order_exists(*order_id))
+                return order_id;
+            remove(live_ids, order_id);
+        }
+        return nullptr;
+    }
+
+    static void remove(std::vector<OrderId>& live_ids, OrderId* order_id)
+    {
+        *order_id = live_ids.back();
+        live_ids.pop_back();
+    }
+};
+
+/**
+ * @brief A single @a OrderBook, called directly.
+ */
+class SingleBook
+{
+  public:
+    explicit SingleBook(const OrderFlowConfig&)
+      : m_order_book{ OrderBookConfig{ .num_ticks = num_ticks,
+                                      .order_pool_capacity = 1u << 17 } }
+    {
+    }
+
+    OrderId add_order(OrderType order_type,
+                      uint32_t,
+                      Side side,
+                      Price price,
+                      Quantity quantity)
+    {
+        return m_order_book.add_order(order_type, 1u, side, "MSFT", price, quantity);
+    }
+    bool order_exists(OrderId order_id) { return m_order_book.order_exists(order_id); }
+    Order& get_order(OrderId order_id) { return m_order_book.get_order(order_id); }
+    void cancel_order(OrderId order_id) { m_order_book.cancel_order(order_id); }
+    void modify_order(OrderId order_id, Price new_price, Quantity new_quantity)
+    {
+        m_order_book.modify_order(order_id, new_price, new_quantity);
+    }
+    void schedule_expiry(OrderId order_id, Timestamp expire_time)
+    {
+        m_order_book.schedule_expiry(order_id, expire_time);
+    }
+    void expire_orders(Timestamp now, std::size_t max_orders)
+    {
+        m_order_book.expire_orders(now, max_orders);
+    }
+
+  private:
+    OrderBook m_order_book;
+};
+
+/**
+ * @brief Books of several symbols behind a @a MarketDataManager, routed by
+ * symbol name on every call.
+ */
+class ManagedBooks
+{
+  public:
+    explicit ManagedBooks(const OrderFlowConfig& config)
+      : m_market_data_manager{ OrderBookConfig{ .num_ticks = num_ticks,
+                                                .order_pool_capacity = 1u << 12 },
+                               config.num_symbols }
+      , m_symbol_names{}
+    {
+        for (std::size_t i{ 0 }; i < config.num_symbols; ++i) {
+            m_symbol_names.push_back(std::format("S{}", i));
+            m_market_data_manager.add_symbol(m_symbol_names.back());
+        }
+    }
+
+    OrderId add_order(OrderType order_type,
+                      uint32_t symbol_index,
+                      Side side,
+                      Price price,
+                      Quantity quantity)
+    {
+        return m_market_data_manager.add_order(
+          order_type, 1u, side, m_symbol_names[symbol_index], price, quantity);
+    }
+    bool order_exists(OrderId order_id)
+    {
+        return m_market_data_manager.get_order_book(order_id.get_symbol_name())
+          .order_exists(order_id);
+    }
+    Order& get_order(OrderId order_id)
+    {
+        return m_market_data_manager.get_order(order_id);
+    }
+    void cancel_order(OrderId order_id) { m_market_data_manager.cancel_order(order_id); }
+    void modify_order(OrderId order_id, Price new_price, Quantity new_quantity)
+    {
+        m_market_data_manager.modify_order(order_id, new_price, new_quantity);
+    }
+    void schedule_expiry(OrderId order_id, Timestamp expire_time)
+    {
+        m_market_data_manager.get_order_book(order_id.get_symbol_name())
+          .schedule_expiry(order_id, expire_time);
+    }
+    void expire_orders(Timestamp now, std::size_t max_orders)
+    {
+        m_market_data_manager.expire_orders(now, max_orders);
+    }
+
+  private:
+    MarketDataManager m_market_data_manager;
+    std::vector<std::string> m_symbol_names;
+};
+
+/**
+ * @brief Time @a config's flow one message per iteration. Every
+ * `flow_size` messages the books are rebuilt from the initial depth, outside
+ * the timed region, so that runs are repeatable whatever the iteration count.
+ */
+template<typename Books>
+void
+run_flow(benchmark::State& state, const OrderFlowConfig& config)
+{
+    OrderFlowGenerator generator{ config };
+    const std::vector<FlowMessage> book = generator.generate_book();
+    const std::vector<FlowMessage> flow = generator.generate(flow_size);
+
+    std::unique_ptr<FlowDriver<Books>> driver;
+    std::size_t next_message = flow.size();
+    for (auto _ : state) {
+        if (next_message == flow.size()) {
+            state.PauseTiming();
+            driver = std::make_unique<FlowDriver<Books>>(config);
+            for (const FlowMessage& message : book)
+                driver->apply(message);
+            next_message = 0;
+            state.ResumeTiming();
+        }
+        driver->apply(flow[next_message++]);
+    }
+
+    // Reported as ns per message and messages per second
+    state.SetItemsProcessed(state.iterations());
+}
+}
+
+static void
+BM_OrderBook_AddOrder(benchmark::State& state)
+{
+    run_flow<SingleBook>(
+      state,
+      OrderFlowConfig{ .book_depth = static_cast<std::size_t>(state.range(0)),
+                       .mean_price_distance = static_cast<double>(state.range(1)),
+                       .add_weight = 1.0,
+                       .cancel_weight = 0.0,
+                       .modify_weight = 0.0,
+                       .market_weight = 0.0 });
+}
+BENCHMARK(BM_OrderBook_AddOrder)
+  ->ArgNames({ "depth", "distance" })
+  ->ArgsProduct({ { 100, 10000 }, { 1, 8, 64 } });
+
+static void
+BM_OrderBook_CancelOrder(benchmark::State& state)
+{
+    // Adds replace the orders the cancels remove, so the book stays near its
+    // initial depth; a pure cancel flow would empty it
+    run_flow<SingleBook>(
+      state,
+      OrderFlowConfig{ .book_depth = static_cast<std::size_t>(state.range(0)),
+                       .add_weight = 0.5,
+                       .cancel_weight = 0.5,
+                       .modify_weight = 0.0,
+                       .market_weight = 0.0 });
+}
+BENCHMARK(BM_OrderBook_CancelOrder)->ArgName("depth")->Arg(100)->Arg(10000);
+
+static void
+BM_OrderBook_ModifyOrder(benchmark::State& state)
+{
+    run_flow<SingleBook>(
+      state,
+      OrderFlowConfig{ .book_depth = static_cast<std::size_t>(state.range(0)),
+                       .add_weight = 0.0,
+                       .cancel_weight = 0.0,
+                       .modify_weight = 1.0,
+                       .market_weight = 0.0 });
+}
+BENCHMARK(BM_OrderBook_ModifyOrder)->ArgName("depth")->Arg(100)->Arg(10000);
+
+static void
+BM_OrderBook_MixedFlow(benchmark::State& state)
+{
+    run_flow<SingleBook>(
+      state,
+      OrderFlowConfig{ .book_depth = static_cast<std::size_t>(state.range(0)),
+                       .mean_price_distance = static_cast<double>(state.range(1)),
+                       .market_weight = static_cast<double>(state.range(2)) / 100.0 });
+}
+BENCHMARK(BM_OrderBook_MixedFlow)
+  ->ArgNames({ "depth", "distance", "market_pct" })
+  ->ArgsProduct({ { 100, 10000 }, { 1, 8, 64 }, { 5, 30 } });
+
+static void
+BM_OrderBook_TimedExpiry(benchmark::State& state)
+{
+    // Orders live for `lifetime_us` after their arrival time, the initial book
+    // expiring all at once
+    run_flow<SingleBook>(
+      state,
+      OrderFlowConfig{ .book_depth = static_cast<std::size_t>(state.range(0)),
+                       .order_lifetime = static_cast<Timestamp>(state.range(1)) * 1000 });
+}
+BENCHMARK(BM_OrderBook_TimedExpiry)
+  ->ArgNames({ "depth", "lifetime_us" })
+  ->ArgsProduct({ { 100, 10000 }, { 10, 1000 } });
+
+static void
+BM_MarketDataManager_MixedFlow(benchmark::State& state)
+{
+    run_flow<ManagedBooks>(
+      state,
+      OrderFlowConfig{ .num_symbols = static_cast<std::size_t>(state.range(0)),
+                       .book_depth = 100,
+                       .market_weight = static_cast<double>(state.range(1)) / 100.0 });
+}
+BENCHMARK(BM_MarketDataManager_MixedFlow)
+  ->ArgNames({ "symbols", "market_pct" })
+  ->ArgsProduct({ { 1, 16, 128 }, { 5, 30 } });
+
+BENCHMARK_MAIN();
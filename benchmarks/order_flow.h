@@ -0,0 +1,178 @@
+#ifndef ORDER_FLOW_H
+#define ORDER_FLOW_H
+
+#include "usings.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace dev {
+
+/**
+ * @brief Parameters of a synthetic order flow.
+ *
+ * Adds, cancels, modifies and market orders arrive as independent Poisson
+ * processes whose rates are `arrival_rate` times their weight, so that the
+ * merged stream has exponential inter-arrival times and a categorical mix.
+ * Limit prices rest `1 + d` ticks away from `mid_price` on their side, with
+ * `d` geometrically distributed with mean `mean_price_distance`. Every symbol
+ * starts with `book_depth` resting orders per side.
+ *
+ * Messages are stamped with their arrival time in nanoseconds. If
+ * `order_lifetime` is set, the driver of the flow expires every resting order
+ * that many nanoseconds after its arrival, the initial book at that time.
+ */
+struct OrderFlowConfig
+{
+    std::size_t num_symbols{ 1u };
+    std::size_t book_depth{ 1000u };
+    Price mid_price{ 1u << 10 };
+    double mean_price_distance{ 8.0 };
+    Quantity max_quantity{ 100u };
+    double arrival_rate{ 1e6 };
+    double add_weight{ 0.5 };
+    double cancel_weight{ 0.3 };
+    double modify_weight{ 0.15 };
+    double market_weight{ 0.05 };
+    Timestamp order_lifetime{ 0u };
+    uint64_t seed{ 42u };
+};
+
+enum class FlowAction : uint8_t
+{
+    ADD,
+    CANCEL,
+    MODIFY,
+    MARKET,
+};
+
+/**
+ * @brief One message of a synthetic flow. CANCEL and MODIFY address a live
+ * order of @a symbol_index by @a target, taken modulo the number of live
+ * orders by the driver, which alone knows what has been filled.
+ */
+struct FlowMessage
+{
+    FlowAction action;
+    Side side;
+    uint32_t symbol_index;
+    Price price;
+    Quantity quantity;
+    uint64_t target;
+    Timestamp arrival_time;
+};
+
+/**
+ * @brief An @a OrderFlowGenerator draws repeatable order flows: the same
+ * configuration always yields the same messages.
+ */
+class OrderFlowGenerator
+{
+  public:
+    explicit OrderFlowGenerator(const OrderFlowConfig& config)
+      : m_config{ config }
+      , m_engine{ config.seed }
+      , m_action{ { config.add_weight,
+                    config.cancel_weight,
+                    config.modify_weight,
+                    config.market_weight } }
+      , m_inter_arrival{ config.arrival_rate }
+      , m_price_distance{ 1.0 / (1.0 + config.mean_price_distance) }
+      , m_quantity{ 1u, config.max_quantity }
+      , m_symbol{ 0u, static_cast<uint32_t>(config.num_symbols - 1) }
+      , m_side{ 0.5 }
+      , m_target{}
+      , m_time{ 0.0 }
+    {
+    }
+
+    /**
+     * @brief The resting orders every book starts from: `book_depth` limit
+     * orders per side and symbol.
+     */
+    std::vector<FlowMessage> generate_book()
+    {
+        std::vector<FlowMessage> messages;
+        messages.reserve(2 * m_config.book_depth * m_config.num_symbols);
+        for (uint32_t symbol_index{ 0 }; symbol_index < m_config.num_symbols;
+             ++symbol_index) {
+            for (std::size_t i{ 0 }; i < m_config.book_depth; ++i) {
+                for (Side side : { 'B', 'S' }) {
+                    FlowMessage message = make_add(side);
+                    message.symbol_index = symbol_index;
+                    messages.push_back(message);
+                }
+            }
+        }
+        return messages;
+    }
+
+    /**
+     * @brief The next @a num_messages messages of the flow.
+     */
+    std::vector<FlowMessage> generate(std::size_t num_messages)
+    {
+        std::vector<FlowMessage> messages;
+        messages.reserve(num_messages);
+        for (std::size_t i{ 0 }; i < num_messages; ++i) {
+            m_time += m_inter_arrival(m_engine);
+            Side side = m_side(m_engine) ? 'B' : 'S';
+            auto action = static_cast<FlowAction>(m_action(m_engine));
+
+            FlowMessage message{};
+            switch (action) {
+                case FlowAction::ADD:
+                    message = make_add(side);
+                    break;
+                case FlowAction::MODIFY:
+                    message = make_add(side);
+                    message.target = m_target(m_engine);
+                    break;
+                case FlowAction::CANCEL:
+                    message.target = m_target(m_engine);
+                    break;
+                case FlowAction::MARKET:
+                    message.side = side;
+                    message.quantity = m_quantity(m_engine);
+                    break;
+            }
+            message.action = action;
+            message.symbol_index = m_symbol(m_engine);
+            message.arrival_time = static_cast<Timestamp>(m_time * 1e9);
+            messages.push_back(message);
+        }
+        return messages;
+    }
+
+  private:
+    OrderFlowConfig m_config;
+    std::mt19937_64 m_engine;
+    std::discrete_distribution<int> m_action;
+    std::exponential_distribution<double> m_inter_arrival;
+    std::geometric_distribution<Price> m_price_distance;
+    std::uniform_int_distribution<Quantity> m_quantity;
+    std::uniform_int_distribution<uint32_t> m_symbol;
+    std::bernoulli_distribution m_side;
+    std::uniform_int_distribution<uint64_t> m_target;
+
+    // Seconds since the start of the flow
+    double m_time;
+
+    FlowMessage make_add(Side side)
+    {
+        Price distance = 1 + m_price_distance(m_engine);
+        distance = std::min(distance, m_config.mid_price - 1);
+        return FlowMessage{ .action = FlowAction::ADD,
+                            .side = side,
+                            .symbol_index = 0,
+                            .price = side == 'B' ? m_config.mid_price - distance
+                                                 : m_config.mid_price + distance,
+                            .quantity = m_quantity(m_engine),
+                            .target = 0,
+                            .arrival_time = 0 };
+    }
+};
+}
+#endif
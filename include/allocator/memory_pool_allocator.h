@@ -1,11 +1,12 @@
-#include "memory_pool.h"
+#include "caching_memory_pool.h"
 
 namespace dev
 {
     /**
      * @brief 
      * A minimal allocator to request chunks of various sizes
-     * from the MemoryPool.
+     * from the MemoryPool. Allocators of the same `id` may be used
+     * from several threads at once, through thread-local magazines.
      * @tparam T 
      */
     template<typename T, std::size_t id=1>
@@ -75,12 +76,12 @@ namespace dev
         /**
          * @brief 
          * When `MemoryPoolAllocator<T,PoolId>` is constructed,
-         * a singleton global `MemoryPool` object is allocated
+         * a singleton global `CachingMemoryPool` object is allocated
          * only once at initialization. Wrapping it in a function
          * ensures the  `MemoryPoolAllocator` is stateless.
          * @return auto& 
          */
-        static auto& memoryPool() { static MemoryPool<id> singleton; return singleton; }
+        static auto& memoryPool() { return CachingMemoryPool<id>::instance(); }
     };
 
     /**
@@ -0,0 +1,348 @@
+#ifndef __ATOMIC_BUCKET_H__
+#define __ATOMIC_BUCKET_H__
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace dev{
+    /**
+     * @brief
+     * A `Bucket` that many threads may allocate from and free to at once,
+     * without locks. Its ledger words are atomic: blocks are claimed by a
+     * compare-and-swap that sets their bits, and released by a `fetch_and`
+     * that clears them.
+     *
+     * A run of blocks within one ledger word is claimed with a single
+     * compare-and-swap. A run spanning words is claimed word by word and
+     * rolled back if another thread got to one of them first, in which
+     * case the search resumes at the run's first word, so that the free
+     * blocks of the run after the taken one are considered again. A claim
+     * losing a race is thus always retried, and an allocation only fails
+     * after a scan found no run; blocks freed behind the scan while it
+     * runs may still be missed, as in any scan of a changing ledger.
+     *
+     * Threads do not all start their search at the same word, which
+     * would make its cache line the one every allocation fights over:
+     * each thread starts at its own offset from the hint, spread over the
+     * ledger. The hint only moves on a successful claim, to the claimed
+     * word less that offset, and is advisory: blocks may have been freed
+     * before the start word, so a search that fails is retried once from
+     * the first word.
+     */
+    class AtomicBucket{
+        public:
+            const std::size_t BlockSize;
+            const std::size_t BlockCount;
+
+            AtomicBucket(std::size_t block_size, std::size_t block_count)
+            : AtomicBucket(block_size, block_count, nullptr)
+            {}
+
+            /**
+             * @brief
+             * Construct a bucket over `data`, which must hold `BlockSize *
+             * BlockCount` bytes and outlive the bucket. A bucket given no
+             * data allocates, zeroes and owns its own; given data is used as
+             * is, so that pages not yet touched stay unbacked.
+             */
+            AtomicBucket(std::size_t block_size, std::size_t block_count, std::byte* data)
+            : BlockSize(block_size)
+            , BlockCount(block_count)
+            , m_data(data)
+            , m_owns_data(data == nullptr)
+            {
+                const auto data_size = BlockSize * BlockCount;
+                if(m_owns_data)
+                    m_data = static_cast<std::byte*>(std::malloc(data_size));
+                assert(m_data != nullptr && "Memory allocation failed");
+                if(m_owns_data)
+                    std::memset(m_data, 0, data_size);
+
+                // Both bitmaps share one zero-initialized allocation
+                m_ledger = new std::atomic<std::uint64_t>[2 * ledger_size()]();
+                m_run_ends = m_ledger + ledger_size();
+
+                // The bits past the last block are permanently in use, so
+                // scans never need to check for the end of the bucket
+                const std::size_t num_tail_blocks = BlockCount % bits_per_word;
+                if(num_tail_blocks != 0)
+                    m_ledger[ledger_size() - 1].store(~std::uint64_t{0} << num_tail_blocks);
+            }
+
+            AtomicBucket(AtomicBucket const &) = delete;
+            AtomicBucket& operator=(AtomicBucket const &) = delete;
+
+            ~AtomicBucket(){
+                if(m_owns_data)
+                    std::free(m_data);
+                delete[] m_ledger;
+            }
+
+            bool belongs(void* ptr) const noexcept{
+                std::byte* lower_boundary = m_data;
+                std::byte* upper_boundary = m_data + (BlockSize * BlockCount);
+
+                return ((ptr >= lower_boundary) && (ptr < upper_boundary));
+            }
+
+            /**
+             * @brief
+             * Claims enough contiguous blocks for `bytes`, or returns
+             * `nullptr` if there is no such run.
+             */
+            void* allocate(std::size_t bytes) noexcept{
+                const std::size_t num_blocks = 1 + ((bytes - 1) / BlockSize);
+
+                const std::size_t offset = thread_offset() % ledger_size();
+                const std::size_t hint = m_hint.load(std::memory_order_relaxed);
+                const std::size_t start = (hint + offset) % ledger_size();
+                std::size_t index = claim_contiguous_blocks(start, num_blocks);
+                if(index == BlockCount && start != 0)
+                    index = claim_contiguous_blocks(0, num_blocks);
+                if(index == BlockCount)
+                    return nullptr;
+
+                const std::size_t new_hint =
+                    (index / bits_per_word + ledger_size() - offset) % ledger_size();
+                if(new_hint != hint)
+                    m_hint.store(new_hint, std::memory_order_relaxed);
+
+                set_run_end(index + num_blocks - 1, true);
+                return m_data + (index * BlockSize);
+            }
+
+            void deallocate(void* ptr, std::size_t bytes) noexcept{
+                const std::size_t num_blocks = 1 + ((bytes - 1) / BlockSize);
+                const std::size_t index = block_index(ptr);
+
+                set_run_end(index + num_blocks - 1, false);
+                release_blocks(index, num_blocks);
+            }
+
+            /**
+             * @brief
+             * Frees the allocation starting at `ptr` without knowing its size:
+             * the allocation ends at the first run end at or after its first
+             * block. No other allocation can set a run end inside it. A
+             * pointer that is not the start of an allocation is caught by an
+             * assertion, and ignored if assertions are off.
+             */
+            void deallocate(void* ptr) noexcept{
+                const std::size_t index = block_index(ptr);
+                assert(index < BlockCount
+                    && (m_ledger[index / bits_per_word].load(std::memory_order_relaxed)
+                        >> (index % bits_per_word) & 1)
+                    && "Freeing a block that is not in use");
+
+                std::size_t word = index / bits_per_word;
+                std::uint64_t run_ends = m_run_ends[word].load(std::memory_order_relaxed)
+                    & (~std::uint64_t{0} << (index % bits_per_word));
+                while(run_ends == 0 && ++word < ledger_size())
+                    run_ends = m_run_ends[word].load(std::memory_order_relaxed);
+                assert(run_ends != 0 && "An allocation has no run end");
+                if(run_ends == 0)
+                    return;
+
+                const std::size_t last = word * bits_per_word + std::countr_zero(run_ends);
+                set_run_end(last, false);
+                release_blocks(index, last - index + 1);
+            }
+
+        private:
+            static constexpr std::size_t bits_per_word = 64;
+            static constexpr std::uint64_t full_word = ~std::uint64_t{0};
+
+            std::size_t ledger_size() const noexcept{
+                return 1 + ((BlockCount - 1) / bits_per_word);
+            }
+
+            std::size_t block_index(void* ptr) const noexcept{
+                return static_cast<std::size_t>(static_cast<std::byte*>(ptr) - m_data) / BlockSize;
+            }
+
+            /**
+             * @brief
+             * A number of the calling thread, scattered by Fibonacci hashing
+             * so that the threads' start words are spread over any ledger.
+             * The first thread to allocate gets 0.
+             */
+            static std::size_t thread_offset() noexcept{
+                static std::atomic<std::uint64_t> num_threads{0};
+                thread_local const std::size_t offset = static_cast<std::size_t>(
+                    (num_threads.fetch_add(1, std::memory_order_relaxed)
+                        * 0x9E3779B97F4A7C15ull) >> 32);
+                return offset;
+            }
+
+            static std::uint64_t low_mask(std::size_t n) noexcept{
+                return (n == bits_per_word) ? full_word : (std::uint64_t{1} << n) - 1;
+            }
+
+            /**
+             * @brief
+             * Finds and claims `n` free contiguous blocks from ledger word
+             * `first_word` on, and returns the first block's index or
+             * `BlockCount` on failure.
+             */
+            std::size_t claim_contiguous_blocks(std::size_t first_word, std::size_t n) noexcept{
+                // Length and start of the run of free blocks reaching the end of
+                // the previous word
+                std::size_t run_length{0};
+                std::size_t run_start{0};
+                for(std::size_t i{first_word}; i < ledger_size(); ++i){
+                    const std::size_t word_start = i * bits_per_word;
+                    std::uint64_t used = m_ledger[i].load(std::memory_order_relaxed);
+
+                    while(true){
+                        const std::uint64_t free_bits = ~used;
+
+                        // The run carried over from the previous words comes first
+                        const std::size_t leading_free = std::countr_one(free_bits);
+                        if(run_length + leading_free >= n){
+                            if(run_length == 0){
+                                if(claim_in_word(i, used, low_mask(n)))
+                                    return word_start;
+                                continue;
+                            }
+                            if(claim_across_words(run_start, n))
+                                return run_start;
+
+                            // Rescan from the run's first word
+                            i = run_start / bits_per_word - 1;
+                            run_length = 0;
+                            break;
+                        }
+                        if(free_bits == full_word){
+                            if(run_length == 0)
+                                run_start = word_start;
+                            run_length += bits_per_word;
+                            break;
+                        }
+
+                        // Then a run entirely inside the word: bit j of `starts` is
+                        // set iff blocks j..j+n-1 of the word are all free
+                        if(n <= bits_per_word){
+                            std::uint64_t starts = free_bits;
+                            for(std::size_t length{1}; length < n && starts != 0;){
+                                const std::size_t shift = std::min(length, n - length);
+                                starts &= starts >> shift;
+                                length += shift;
+                            }
+                            if(starts != 0){
+                                const std::size_t bit = std::countr_zero(starts);
+                                if(claim_in_word(i, used, low_mask(n) << bit))
+                                    return word_start + bit;
+                                continue;
+                            }
+                        }
+
+                        // Finally, the free blocks at the top of the word may start a
+                        // run that continues in the next one
+                        run_length = std::countl_one(free_bits);
+                        run_start = word_start + bits_per_word - run_length;
+                        break;
+                    }
+                }
+
+                return BlockCount;
+            }
+
+            /**
+             * @brief
+             * Sets the bits of `mask` in word `word` if they are still free
+             * in `used`. On failure `used` is the word's current value.
+             */
+            bool claim_in_word(std::size_t word, std::uint64_t& used, std::uint64_t mask) noexcept{
+                return m_ledger[word].compare_exchange_weak(
+                    used, used | mask, std::memory_order_acquire, std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief
+             * Claims blocks `index` to `index + n - 1` one word at a time,
+             * releasing the words claimed so far if one is taken.
+             */
+            bool claim_across_words(std::size_t index, std::size_t n) noexcept{
+                std::size_t word = index / bits_per_word;
+                std::size_t bit = index % bits_per_word;
+                std::size_t num_claimed{0};
+                while(num_claimed != n){
+                    const std::size_t num_bits = std::min(n - num_claimed, bits_per_word - bit);
+                    const std::uint64_t mask = low_mask(num_bits) << bit;
+                    std::uint64_t used = m_ledger[word].load(std::memory_order_relaxed);
+                    do{
+                        if((used & mask) != 0){
+                            if(num_claimed != 0)
+                                release_blocks(index, num_claimed);
+                            return false;
+                        }
+                    }while(!claim_in_word(word, used, mask));
+
+                    num_claimed += num_bits;
+                    bit = 0;
+                    ++word;
+                }
+                return true;
+            }
+
+            /**
+             * @brief
+             * Clears the ledger bits of blocks `index` to `index + n - 1`,
+             * publishing the writes made to them to their next owner.
+             */
+            void release_blocks(std::size_t index, std::size_t n) noexcept{
+                std::size_t word = index / bits_per_word;
+                std::size_t bit = index % bits_per_word;
+                std::size_t remaining = n;
+
+                while(remaining != 0){
+                    const std::size_t num_bits = std::min(remaining, bits_per_word - bit);
+                    m_ledger[word].fetch_and(~(low_mask(num_bits) << bit), std::memory_order_release);
+                    remaining -= num_bits;
+                    bit = 0;
+                    ++word;
+                }
+            }
+
+            /**
+             * @brief
+             * Sets or clears the run-end bit of block `index`. A run end is
+             * only set by the thread that claimed the block and cleared
+             * before the block is released.
+             */
+            void set_run_end(std::size_t index, bool set_or_clear_flag) noexcept{
+                const std::uint64_t mask = std::uint64_t{1} << (index % bits_per_word);
+                if(set_or_clear_flag)
+                    m_run_ends[index / bits_per_word].fetch_or(mask, std::memory_order_relaxed);
+                else
+                    m_run_ends[index / bits_per_word].fetch_and(~mask, std::memory_order_relaxed);
+            }
+
+            std::byte* m_data{nullptr};
+            bool m_owns_data{true};
+
+            /**
+             * @brief One bit per block, set while the block is in use.
+             */
+            std::atomic<std::uint64_t>* m_ledger{nullptr};
+
+            /**
+             * @brief One bit per block, set on the last block of every
+             * allocation. It shares the ledger's allocation.
+             */
+            std::atomic<std::uint64_t>* m_run_ends{nullptr};
+
+            /**
+             * @brief Ledger word the first thread starts its search at, the
+             * others at their offset from it. On its own cache line.
+             */
+            alignas(64) std::atomic<std::size_t> m_hint{0};
+    };
+}
+
+#endif
@@ -1,8 +1,11 @@
 #ifndef __BUCKET_H__
 #define __BUCKET_H__
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
-#include <bitset>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 
@@ -13,6 +16,15 @@ namespace dev{
      * An instance of `Bucket` has `BlockCount` blocks each of size
      * `BlockSize`. The `BucketSize = BlockSize * BlockCount`. 
      * 
+     * The ledger keeps one bit per block in 64-bit words, so that a word
+     * of in-use blocks is skipped with one comparison and a free block is
+     * found with `countr_zero`. A hint cursor remembers the first word that
+     * may have a free block, which keeps first-fit allocation close to O(1)
+     * even when the bucket is nearly full.
+     * 
+     * A second bitmap marks the last block of every allocation, so that
+     * a pointer can be freed without its size.
+     * 
      * Ref Implementation:
      * https://www.youtube.com/watch?v=l14Zkx5OXr4
      */
@@ -22,20 +34,42 @@ namespace dev{
             const std::size_t BlockCount;
 
             Bucket(std::size_t block_size, std::size_t block_count)
+            : Bucket(block_size, block_count, nullptr)
+            {}
+
+            /**
+             * @brief 
+             * Construct a bucket over `data`, which must hold `BlockSize *
+             * BlockCount` bytes and outlive the bucket. A bucket given no
+             * data allocates, zeroes and owns its own; given data is used as
+             * is, so that pages not yet touched stay unbacked.
+             */
+            Bucket(std::size_t block_size, std::size_t block_count, std::byte* data)
             : BlockSize(block_size)
             , BlockCount(block_count)
+            , m_data(data)
+            , m_owns_data(data == nullptr)
             {
                 const auto data_size = BlockSize * BlockCount;
-                m_data = static_cast<std::byte*>(std::malloc(data_size));
+                if(m_owns_data)
+                    m_data = static_cast<std::byte*>(std::malloc(data_size));
                 assert(m_data != nullptr && "Memory allocation failed");
                 
-                const auto ledger_size = 1 + ((BlockCount - 1) / 8);
-                m_ledger = static_cast<std::bitset<8>*>(std::malloc(ledger_size));
+                m_ledger = static_cast<std::uint64_t*>(
+                    std::malloc(2 * ledger_size() * sizeof(std::uint64_t)));
                 assert(m_ledger != nullptr && "Memory allocation for ledger failed");
+                m_run_ends = m_ledger + ledger_size();
         
-                // Initialize the blocks and the ledger, we zero everything out
-                std::memset(m_data, 0, data_size);
-                std::memset(m_ledger, 0, ledger_size);
+                // Initialize the blocks and the ledgers, we zero everything out
+                if(m_owns_data)
+                    std::memset(m_data, 0, data_size);
+                std::memset(m_ledger, 0, 2 * ledger_size() * sizeof(std::uint64_t));
+
+                // The bits past the last block are permanently in use, so
+                // scans never need to check for the end of the bucket
+                const std::size_t num_tail_blocks = BlockCount % bits_per_word;
+                if(num_tail_blocks != 0)
+                    m_ledger[ledger_size() - 1] = ~std::uint64_t{0} << num_tail_blocks;
             }
     
             /**
@@ -43,7 +77,8 @@ namespace dev{
              * Just free the memory allocated for the data and the ledger.
              */
             ~Bucket(){
-                std::free(m_data);
+                if(m_owns_data)
+                    std::free(m_data);
                 std::free(m_ledger);
             }
             
@@ -77,6 +112,7 @@ namespace dev{
                     return nullptr;
         
                 set_blocks_in_use(next_free_index, num_blocks);
+                set_run_end(next_free_index + num_blocks - 1, true);
                 
                 void* ptr_to_newly_alloc_mem = m_data + (next_free_index * BlockSize);
 
@@ -103,76 +139,132 @@ namespace dev{
     
                 // Update the ledger
                 set_blocks_free(index, num_blocks);
+                set_run_end(index + num_blocks - 1, false);
                 //std::cout << "\n" << "Deallocated " << bytes 
                 //<< " bytes at address " << block_offset << std::endl;;
             }
+
+            /**
+             * @brief 
+             * Frees the allocation starting at `ptr` without knowing its size:
+             * the allocation ends at the first run end at or after its first
+             * block. A pointer that is not the start of an allocation is
+             * caught by an assertion, and ignored if assertions are off.
+             * @param ptr 
+             */
+            void deallocate(void* ptr) noexcept{
+                const std::size_t index =
+                    static_cast<std::size_t>(static_cast<std::byte*>(ptr) - m_data) / BlockSize;
+                assert(index < BlockCount
+                    && (m_ledger[index / bits_per_word] >> (index % bits_per_word) & 1)
+                    && "Freeing a block that is not in use");
+
+                std::size_t word = index / bits_per_word;
+                std::uint64_t run_ends =
+                    m_run_ends[word] & (~std::uint64_t{0} << (index % bits_per_word));
+                while(run_ends == 0 && ++word < ledger_size())
+                    run_ends = m_run_ends[word];
+                assert(run_ends != 0 && "An allocation has no run end");
+                if(run_ends == 0)
+                    return;
+
+                const std::size_t last = word * bits_per_word + std::countr_zero(run_ends);
+                set_blocks_free(index, last - index + 1);
+                set_run_end(last, false);
+            }
             
             /**
              * @brief 
              * Finds `n` free contigous blocks in the bucket and returns the first
-             * block's index or `BlockCount` on failure.
+             * block's index or `BlockCount` on failure. The lowest such index is
+             * returned, as the words before the hint cursor are known to be full.
              * @param n 
              * Number of free contigous blocks requested.
              * @return std::size_t 
              */
             std::size_t find_contiguous_blocks(std::size_t n) noexcept{
-                
-                int num_free_blocks_found_ctr{0};
-                std::size_t index{0};
-                std::size_t first_free_block_index_in_free_area_found{0};
-                const auto ledger_size = 1 + ((BlockCount - 1) / 8);
-                
-                int j{0};
-                for(int i{0}; i<ledger_size;++i){
-                    for(int j{0};j<8;++j)
-                    {
-                        if(!m_ledger[i].test(j))
-                        {
-                            ++num_free_blocks_found_ctr;
-                        }
-                        else{
-                            first_free_block_index_in_free_area_found = index + 1;
-                            num_free_blocks_found_ctr = 0;
-                        }
+                // Skip the full words at the hint cursor for good
+                while(m_hint < ledger_size() && m_ledger[m_hint] == ~std::uint64_t{0})
+                    ++m_hint;
+
+                if(n == 1){
+                    if(m_hint == ledger_size())
+                        return BlockCount;
+                    return m_hint * bits_per_word + std::countr_zero(~m_ledger[m_hint]);
+                }
 
-                        if(num_free_blocks_found_ctr >= n)
-                            return first_free_block_index_in_free_area_found;
-                        ++index;
+                // Length and start of the run of free blocks reaching the end of
+                // the previous word
+                std::size_t run_length{0};
+                std::size_t run_start{0};
+                for(std::size_t i{m_hint}; i < ledger_size(); ++i){
+                    const std::uint64_t free_bits = ~m_ledger[i];
+                    const std::size_t word_start = i * bits_per_word;
+
+                    // The run carried over from the previous words comes first
+                    const std::size_t leading_free = std::countr_one(free_bits);
+                    if(run_length + leading_free >= n)
+                        return run_length == 0 ? word_start : run_start;
+                    if(free_bits == ~std::uint64_t{0}){
+                        if(run_length == 0)
+                            run_start = word_start;
+                        run_length += bits_per_word;
+                        continue;
+                    }
+
+                    // Then a run entirely inside the word: bit j of `starts` is
+                    // set iff blocks j..j+n-1 of the word are all free
+                    if(n <= bits_per_word){
+                        std::uint64_t starts = free_bits;
+                        for(std::size_t length{1}; length < n && starts != 0;){
+                            const std::size_t shift = std::min(length, n - length);
+                            starts &= starts >> shift;
+                            length += shift;
+                        }
+                        if(starts != 0)
+                            return word_start + std::countr_zero(starts);
                     }
+
+                    // Finally, the free blocks at the top of the word may start a
+                    // run that continues in the next one
+                    run_length = std::countl_one(free_bits);
+                    run_start = word_start + bits_per_word - run_length;
                 }
         
                 return BlockCount;
             }
     
+            /**
+             * @brief Sets or clears the ledger bits of blocks `index` to
+             * `index + n - 1`, one word at a time.
+             */
             void set_blocks_status(
                 std::size_t index, 
                 std::size_t n, 
                 bool set_or_clear_flag) noexcept
             {
-                
-                std::size_t ledger_index = (index / 8);
-        
-                // We are interested to flip `n` bits beginning from
-                // (m_ledger + ledger_index * 8 + first_bit_to_set) to
-                // (m_ledger + ledger_index * 8 + first_bit_to_set + (n - 1)).
-                std::size_t first_bit_to_set = index - (ledger_index * 8);
-        
-                std::size_t i{0};
-        
-                // bitset_index follows modulo-8 arithmetic
-                std::size_t bitset_index{first_bit_to_set};
-        
-                while(i < n)
+                std::size_t word = index / bits_per_word;
+                std::size_t bit = index % bits_per_word;
+                std::size_t remaining = n;
+
+                // Freed blocks may lie before the hint cursor
+                if(!set_or_clear_flag)
+                    m_hint = std::min(m_hint, word);
+
+                while(remaining != 0)
                 {
-                    m_ledger[ledger_index].set(bitset_index, set_or_clear_flag);
-                    // Bitwise & is much faster than modulo, which can take
-                    // 40-50 CPU cycles. a % b where b = 2^n, can be implemented
-                    // as (a & (b - 1)).
-                    bitset_index = (bitset_index + 1) & 7u;
-                    if(bitset_index == 0)
-                        ++ledger_index;
-                    
-                    ++i;
+                    const std::size_t num_bits = std::min(remaining, bits_per_word - bit);
+                    const std::uint64_t mask = (num_bits == bits_per_word)
+                        ? ~std::uint64_t{0}
+                        : ((std::uint64_t{1} << num_bits) - 1) << bit;
+                    if(set_or_clear_flag)
+                        m_ledger[word] |= mask;
+                    else
+                        m_ledger[word] &= ~mask;
+
+                    remaining -= num_bits;
+                    bit = 0;
+                    ++word;
                 }
             }
 
@@ -197,6 +289,26 @@ namespace dev{
             }
 
         private:
+            static constexpr std::size_t bits_per_word = 64;
+
+            /**
+             * @brief Sets or clears the run-end bit of block `index`.
+             */
+            void set_run_end(std::size_t index, bool set_or_clear_flag) noexcept{
+                const std::uint64_t mask = std::uint64_t{1} << (index % bits_per_word);
+                if(set_or_clear_flag)
+                    m_run_ends[index / bits_per_word] |= mask;
+                else
+                    m_run_ends[index / bits_per_word] &= ~mask;
+            }
+
+            /**
+             * @brief Number of 64-bit words in the ledger.
+             */
+            std::size_t ledger_size() const noexcept{
+                return 1 + ((BlockCount - 1) / bits_per_word);
+            }
+
             /**
              * @brief 
              * The pointer to data, which is the memory area itself which
@@ -204,14 +316,33 @@ namespace dev{
              */
             std::byte* m_data{nullptr};
 
+            /**
+             * @brief Whether `m_data` was allocated by the bucket, rather
+             * than carved out of its pool's range.
+             */
+            bool m_owns_data{true};
+
             /**
              * @brief A ledger is just a book-keeping mechanism which uses
              * one bit per block to indicate whether it is in use. So, for
              * example, if we allocate block-5 inside `m_data` array, we are
              * going to set bit 5 inside `m_ledger` to `1`. If we deallocate it,
-             * we are going to clear it to `0`.
+             * we are going to clear it to `0`. Block `i` is bit `i % 64` of
+             * word `i / 64`.
+             */
+            std::uint64_t* m_ledger{nullptr};
+
+            /**
+             * @brief One bit per block, set on the last block of every
+             * allocation. It shares the ledger's allocation.
+             */
+            std::uint64_t* m_run_ends{nullptr};
+
+            /**
+             * @brief Index of the first ledger word that may have a free
+             * block: every word before it is full.
              */
-            std::bitset<8>* m_ledger{nullptr};
+            std::size_t m_hint{0};
 
     };
 }
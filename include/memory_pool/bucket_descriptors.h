@@ -3,6 +3,7 @@
 
 #include <tuple>
 #include <type_traits>
+#include <atomic_bucket.h>
 #include <bucket.h>
 /**
  * @brief 
@@ -15,7 +16,9 @@
  * instance, which is just a static collection of bucket configs. 
  * 
  * A bucket_descriptors specialization is a concrete realization 
- * of such a collection.
+ * of such a collection. It may also declare a `bucket_type`, the class
+ * of the buckets, `Bucket` by default: with `AtomicBucket` the pool can
+ * be used from several threads at once.
  */
 
 namespace dev{
@@ -24,6 +27,21 @@ namespace dev{
         using type = std::tuple<>;
     };
 
+    /**
+     * @brief 
+     * A type-metafunction to get the bucket class of pool `id`.
+     * @tparam id 
+     */
+    template<std::size_t id, typename = void>
+    struct bucket_type_of{
+        using type = Bucket;
+    };
+
+    template<std::size_t id>
+    struct bucket_type_of<id, std::void_t<typename bucket_descriptors<id>::bucket_type>>{
+        using type = typename bucket_descriptors<id>::bucket_type;
+    };
+
     // Bucket configurations   
     struct bucket_cfg1{
         static constexpr std::size_t BlockSize = 1;
@@ -96,6 +114,16 @@ namespace dev{
             bucket_cfg1024
         >;
     };
+
+    /**
+     * @brief 
+     * The buckets of pool 1, lock-free.
+     */
+    template<>
+    struct bucket_descriptors<2>{
+        using type = bucket_descriptors<1>::type;
+        using bucket_type = AtomicBucket;
+    };
 }
 
 #endif
\ No newline at end of file
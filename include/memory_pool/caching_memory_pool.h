@@ -0,0 +1,332 @@
+#ifndef __CACHING_MEMORY_POOL_H
+#define __CACHING_MEMORY_POOL_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <memory_pool.h>
+
+/**
+ * @note
+ * A `MemoryPool` is not synchronized, and locking it on every call would
+ * serialize all the threads allocating from it. `CachingMemoryPool` puts
+ * per-thread magazines in front of it instead:
+ * - Every thread keeps a free list of blocks per size class, so that most
+ *   allocations and deallocations touch thread-local memory only.
+ * - A magazine is refilled from the buckets in batches, under the pool's
+ *   lock, which is thus taken once every `batch_size` allocations.
+ * - A magazine that grows past `magazine_capacity` hands a batch over to
+ *   the size class's remote-free list, a lock-free stack other threads
+ *   refill from before going to the buckets. A block allocated by one
+ *   thread and freed by another thus travels back without any lock.
+ * - A remote-free list holds at most `remote_capacity` blocks: batches
+ *   beyond that, and the magazines of an exiting thread, are freed to the
+ *   bucket under the lock, so that the bucket's ledger sees them again.
+ *   At most `magazine_capacity` blocks per size class and thread, plus the
+ *   remote-free lists, are thus hidden from the pool's own allocations,
+ *   and the lists are freed to the buckets when one of those fails.
+ */
+
+namespace dev{
+    /**
+     * @brief
+     * A thread-safe front-end to a `MemoryPool<id>`. Its thread-local state
+     * is per `id`, so there is one instance per `id`, see `instance()`.
+     *
+     * A size class is a bucket whose blocks can hold a pointer, used for
+     * single-block allocations only: a request of `bytes` bytes goes to
+     * the smallest such bucket with `BlockSize >= bytes`. Other requests
+     * and exhausted size classes fall back to the pool under its lock.
+     *
+     * @tparam id Template parameter to select
+     * the pool configuration.
+     */
+    template<std::size_t id=1>
+    class CachingMemoryPool{
+        public:
+        using pool_t = MemoryPool<id>;
+
+        static constexpr std::size_t bucket_count = pool_t::bucket_count;
+
+        /**
+         * @brief
+         * Blocks a thread keeps per size class before handing a batch over
+         * to the remote-free list, and the number of blocks moved at a time.
+         */
+        static constexpr std::size_t magazine_capacity = 64;
+        static constexpr std::size_t batch_size = magazine_capacity / 2;
+
+        /**
+         * @brief
+         * Blocks a size class's remote-free list holds at most.
+         */
+        static constexpr std::size_t remote_capacity = 4 * magazine_capacity;
+
+        static constexpr std::uint8_t no_size_class = 0xff;
+
+        static_assert(bucket_count < no_size_class,
+            "A caching memory pool needs fewer than 255 buckets");
+
+        /**
+         * @brief
+         * A block is cached through an intrusive free list, so it must hold
+         * an aligned pointer.
+         */
+        static constexpr bool is_size_class(std::size_t block_size) noexcept{
+            return block_size >= sizeof(void*) && block_size % alignof(void*) == 0;
+        }
+
+        /**
+         * @brief
+         * The size class of every request size up to the largest block,
+         * or `no_size_class`.
+         */
+        static constexpr auto size_class_table = []{
+            std::array<std::uint8_t, pool_t::max_block_size + 1> table{};
+            for(std::size_t bytes{0}; bytes <= pool_t::max_block_size; ++bytes){
+                table[bytes] = no_size_class;
+                for(std::size_t index{0}; index < bucket_count; ++index){
+                    const auto block_size = pool_t::block_sizes[index];
+                    if(!is_size_class(block_size) || block_size < bytes)
+                        continue;
+                    if(table[bytes] == no_size_class
+                        || block_size < pool_t::block_sizes[table[bytes]])
+                        table[bytes] = static_cast<std::uint8_t>(index);
+                }
+            }
+            return table;
+        }();
+
+        static constexpr std::uint8_t size_class(std::size_t bytes) noexcept{
+            return (bytes <= pool_t::max_block_size) ? size_class_table[bytes] : no_size_class;
+        }
+
+        /**
+         * @brief
+         * The instance of the `id` pool configuration, created on first use.
+         */
+        static CachingMemoryPool& instance(){
+            static CachingMemoryPool singleton;
+            return singleton;
+        }
+
+        CachingMemoryPool(CachingMemoryPool const &) = delete;
+        CachingMemoryPool& operator=(CachingMemoryPool const &) = delete;
+
+        void* allocate(std::size_t bytes){
+            const std::uint8_t index = size_class(bytes);
+            if(index == no_size_class)
+                return allocate_shared(bytes);
+
+            Magazine& magazine = thread_cache().magazines[index];
+            if(magazine.head == nullptr && !refill(magazine, index))
+                return allocate_shared(bytes);
+
+            FreeBlock* block = magazine.head;
+            magazine.head = block->next;
+            --magazine.count;
+            return block;
+        }
+
+        /**
+         * @brief
+         * A block goes back to the freeing thread's magazine when `bytes`
+         * maps to the size class it was allocated from. Anything else is
+         * freed to the pool, which needs no size.
+         */
+        void deallocate(void* ptr, std::size_t bytes){
+            const std::uint8_t index = size_class(bytes);
+            if(index == no_size_class || m_pool.bucket_index(ptr) != index){
+                std::lock_guard<std::mutex> lock{m_mutex};
+                m_pool.deallocate(ptr);
+                return;
+            }
+
+            Magazine& magazine = thread_cache().magazines[index];
+            auto* block = static_cast<FreeBlock*>(ptr);
+            block->next = magazine.head;
+            magazine.head = block;
+            if(++magazine.count >= magazine_capacity)
+                release(magazine, index, batch_size);
+        }
+
+        private:
+        struct FreeBlock{
+            FreeBlock* next;
+        };
+
+        /**
+         * @brief
+         * A thread's free list of one size class.
+         */
+        struct Magazine{
+            FreeBlock* head{nullptr};
+            std::size_t count{0};
+        };
+
+        /**
+         * @brief
+         * The magazines of one thread. The blocks they hold when the
+         * thread exits are freed to their buckets under the lock.
+         */
+        struct ThreadCache{
+            CachingMemoryPool& pool;
+            std::array<Magazine, bucket_count> magazines{};
+
+            ~ThreadCache(){
+                std::lock_guard<std::mutex> lock{pool.m_mutex};
+                for(std::size_t index{0}; index < bucket_count; ++index){
+                    pool.free_to_bucket(magazines[index].head, index);
+                    magazines[index] = Magazine{};
+                }
+            }
+        };
+
+        /**
+         * @brief
+         * A size class's remote-free list, on its own cache line. `count`
+         * is reserved before a batch is pushed and released after it is
+         * popped, so it never under-counts the list.
+         */
+        struct alignas(64) RemoteFreeList{
+            std::atomic<FreeBlock*> head{nullptr};
+            std::atomic<std::size_t> count{0};
+        };
+
+        pool_t m_pool;
+        std::mutex m_mutex;
+        std::array<RemoteFreeList, bucket_count> m_remote_free;
+
+        CachingMemoryPool() = default;
+
+        static ThreadCache& thread_cache(){
+            thread_local ThreadCache cache{instance()};
+            return cache;
+        }
+
+        /**
+         * @brief
+         * Allocates from the pool under its lock. If the pool throws
+         * `std::bad_alloc`, the blocks parked on the remote-free lists are
+         * freed to their buckets and the allocation is retried once.
+         */
+        void* allocate_shared(std::size_t bytes){
+            std::lock_guard<std::mutex> lock{m_mutex};
+            try{
+                return m_pool.allocate(bytes);
+            }catch(const std::bad_alloc&){
+            }
+
+            for(std::size_t index{0}; index < bucket_count; ++index){
+                RemoteFreeList& remote = m_remote_free[index];
+                FreeBlock* head = remote.head.exchange(nullptr, std::memory_order_acquire);
+                remote.count.fetch_sub(free_to_bucket(head, index), std::memory_order_relaxed);
+            }
+            return m_pool.allocate(bytes);
+        }
+
+        /**
+         * @brief
+         * Frees the blocks of the list starting at `head` to bucket `index`
+         * and returns their number. The caller holds `m_mutex`.
+         */
+        std::size_t free_to_bucket(FreeBlock* head, std::size_t index) noexcept{
+            auto& bucket = m_pool.get_bucket(index);
+            std::size_t n{0};
+            while(head != nullptr){
+                FreeBlock* next = head->next;
+                bucket.deallocate(head, bucket.BlockSize);
+                head = next;
+                ++n;
+            }
+            return n;
+        }
+
+        /**
+         * @brief
+         * Refills an empty magazine: with a batch from the remote-free list
+         * if it has blocks, otherwise with a batch from the size class's
+         * bucket. The list is taken with one exchange, which keeps it free
+         * of ABA, and what is left after the batch is pushed back: in one
+         * compare-and-swap if no block was pushed meanwhile, otherwise
+         * after a walk of at most `remote_capacity` blocks.
+         * @return false if the size class is exhausted.
+         */
+        bool refill(Magazine& magazine, std::size_t index){
+            RemoteFreeList& remote = m_remote_free[index];
+            FreeBlock* head = remote.head.exchange(nullptr, std::memory_order_acquire);
+            if(head != nullptr){
+                FreeBlock* last = head;
+                std::size_t n{1};
+                for(; n < batch_size && last->next != nullptr; ++n)
+                    last = last->next;
+                FreeBlock* rest = last->next;
+                last->next = nullptr;
+                magazine.head = head;
+                magazine.count = n;
+                remote.count.fetch_sub(n, std::memory_order_relaxed);
+
+                FreeBlock* empty{nullptr};
+                if(rest != nullptr && !remote.head.compare_exchange_strong(
+                        empty, rest, std::memory_order_release, std::memory_order_relaxed)){
+                    FreeBlock* rest_last = rest;
+                    while(rest_last->next != nullptr)
+                        rest_last = rest_last->next;
+                    push(remote, rest, rest_last);
+                }
+                return true;
+            }
+
+            std::lock_guard<std::mutex> lock{m_mutex};
+            auto& bucket = m_pool.get_bucket(index);
+            for(; magazine.count < batch_size; ++magazine.count){
+                auto* block = static_cast<FreeBlock*>(bucket.allocate(bucket.BlockSize));
+                if(block == nullptr)
+                    break;
+                block->next = magazine.head;
+                magazine.head = block;
+            }
+            return magazine.head != nullptr;
+        }
+
+        /**
+         * @brief
+         * Moves the first `n` blocks of a magazine to the remote-free list
+         * with a single compare-and-swap, or to the bucket under the lock if
+         * the list would grow past `remote_capacity`.
+         */
+        void release(Magazine& magazine, std::size_t index, std::size_t n){
+            FreeBlock* first = magazine.head;
+            FreeBlock* last = first;
+            for(std::size_t i{1}; i < n; ++i)
+                last = last->next;
+            magazine.head = last->next;
+            magazine.count -= n;
+            last->next = nullptr;
+
+            RemoteFreeList& remote = m_remote_free[index];
+            if(remote.count.fetch_add(n, std::memory_order_relaxed) + n > remote_capacity){
+                remote.count.fetch_sub(n, std::memory_order_relaxed);
+                std::lock_guard<std::mutex> lock{m_mutex};
+                free_to_bucket(first, index);
+                return;
+            }
+            push(remote, first, last);
+        }
+
+        /**
+         * @brief
+         * Pushes the chain `first` to `last` onto a remote-free list.
+         */
+        static void push(RemoteFreeList& remote, FreeBlock* first, FreeBlock* last) noexcept{
+            last->next = remote.head.load(std::memory_order_relaxed);
+            while(!remote.head.compare_exchange_weak(
+                last->next, first, std::memory_order_release, std::memory_order_relaxed))
+                ;
+        }
+    };
+}
+
+#endif
@@ -2,11 +2,18 @@
 #define __MEMORY_POOL_H
 
 #include <array>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
 #include <initializer_list>
+#include <new>
 #include <bucket.h>
 #include <bucket_descriptors.h>
 #include <algorithm>
 #include <iostream>
+#include <utility>
+#include <sys/mman.h>
+#include <unistd.h>
 
 /**
  * @note
@@ -34,7 +41,7 @@ namespace dev{
          * @return true 
          * @return false 
          */
-        bool operator<(const Info& other) const noexcept{
+        constexpr bool operator<(const Info& other) const noexcept{
             return (waste == other.waste) ? block_count < other.block_count : (waste < other.waste);
         }
     };
@@ -58,6 +65,12 @@ namespace dev{
          */
         using bucket_descriptors_t = typename bucket_descriptors<id>::type;
 
+        /**
+         * @brief 
+         * The bucket class, `Bucket` unless the descriptors select another.
+         */
+        using bucket_t = typename bucket_type_of<id>::type;
+
         /**
         * @brief 
         * Variable template to get the number of buckets in a 
@@ -90,10 +103,60 @@ namespace dev{
             std::tuple_element_t<BucketIdx,bucket_descriptors_t>::BlockCount
         >{};
 
+        /**
+         * @brief 
+         * Every bucket gets a slot of `slot_size` bytes in the pool's range,
+         * a power of two that fits the largest bucket. The owner of a pointer
+         * is then its offset in the range shifted by `slot_shift`.
+         *
+         * For pool 1 that is 11 slots of 16 MiB, 176 MiB of address space
+         * for 20.7 MB of buckets. The range is only reserved, see
+         * `reserve_range()`: the padding between buckets is never backed by
+         * memory nor charged to the commit limit.
+         */
+        static constexpr std::size_t slot_size =
+            []<std::size_t... Idx>(std::index_sequence<Idx...>){
+                return std::bit_ceil(std::max({get_size<Idx>::value * get_count<Idx>::value...}));
+            }(std::make_index_sequence<bucket_count>{});
+
+        static constexpr std::size_t slot_shift = std::countr_zero(slot_size);
+
+        static constexpr std::size_t range_size = bucket_count * slot_size;
+
+        /**
+         * @brief 
+         * Reserves the pool's range with no access, then makes the pages
+         * of every bucket readable and writable. Those are backed by memory
+         * as they are first touched, the padding stays inaccessible.
+         * Throws `std::bad_alloc` if either step fails.
+         */
+        template<std::size_t... Idx>
+        static std::byte* reserve_range(std::index_sequence<Idx...>){
+            void* range = ::mmap(nullptr, range_size, PROT_NONE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if(range == MAP_FAILED)
+                throw std::bad_alloc{};
+            auto* data = static_cast<std::byte*>(range);
+
+            const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            auto commit = [&](std::size_t offset, std::size_t size){
+                const std::size_t begin = offset / page_size * page_size;
+                const std::size_t end = (offset + size + page_size - 1) / page_size * page_size;
+                return ::mprotect(data + begin, end - begin, PROT_READ | PROT_WRITE) == 0;
+            };
+            if(!(commit(Idx * slot_size, get_size<Idx>::value * get_count<Idx>::value) && ...)){
+                ::munmap(data, range_size);
+                throw std::bad_alloc{};
+            }
+            return data;
+        }
+
         // Constructors
         template<std::size_t... Idx>
-        MemoryPool(std::index_sequence<Idx...>)
-            : m_buckets{Bucket{get_size<Idx>::value, get_count<Idx>::value}...}
+        MemoryPool(std::index_sequence<Idx...> indices)
+            : m_data{reserve_range(indices)}
+            , m_buckets{bucket_t{get_size<Idx>::value, get_count<Idx>::value,
+                                 m_data + Idx * slot_size}...}
             {}
 
         MemoryPool()
@@ -103,6 +166,24 @@ namespace dev{
         MemoryPool(MemoryPool const &) = delete; 
         MemoryPool& operator=(MemoryPool const &) = delete;
 
+        ~MemoryPool(){
+            ::munmap(m_data, range_size);
+        }
+
+        /**
+         * @brief 
+         * The `BlockSize` of every bucket, by bucket index.
+         */
+        static constexpr std::array<std::size_t, bucket_count> block_sizes =
+            []<std::size_t... Idx>(std::index_sequence<Idx...>){
+                return std::array<std::size_t, bucket_count>{get_size<Idx>::value...};
+            }(std::make_index_sequence<bucket_count>{});
+
+        static constexpr std::size_t max_block_size = std::ranges::max(block_sizes);
+
+        static_assert(bucket_count > 0 && bucket_count <= 256,
+            "A memory pool needs between 1 and 256 buckets");
+
         /**
          * @note
          * When allocating from a bucket it is unknown whether the allocation
@@ -113,57 +194,124 @@ namespace dev{
          * would lead to least wasted memory and will take the least amount
          * of blocks. So, we calculate the minimum amount of wasted memory
          * and the minimum amount of wasted blocks and the bucket which 
-         * gives us that is going to be good enough.
+         * gives us that is going to be good enough. The next best buckets
+         * are the fallbacks, in order, when a bucket is exhausted.
+         * 
+         * @return The bucket indices in the order to try them for `bytes`.
          */
-
-        void* allocate(std::size_t bytes){
+        static constexpr std::array<std::uint8_t, bucket_count>
+        make_bucket_order(std::size_t bytes) noexcept{
             std::array<Info,bucket_count> deltas{};
-            std::size_t index {0};
-            for(Bucket& bucket : m_buckets){
-                if(bucket.BlockSize >= bytes)
-                {
-                    deltas[index].waste = bucket.BlockSize - bytes;
-                    deltas[index].block_count = 1;
-                }
-                else{
-                    const auto n = 1 + (bytes - 1) / bucket.BlockSize;
-                    const auto storage_required = n * bucket.BlockSize;
-                    deltas[index].waste = (bytes - storage_required);
-                    deltas[index].block_count = n;
-                }
+            for(std::size_t index{0}; index < bucket_count; ++index){
+                const auto block_size = block_sizes[index];
+                const auto n = (bytes <= block_size) ? 1 : 1 + (bytes - 1) / block_size;
                 deltas[index].index = index;
-                ++index;
+                deltas[index].block_count = n;
+                deltas[index].waste = n * block_size - bytes;
             }
 
             std::sort(deltas.begin(), deltas.end());
 
-            for(const auto& d: deltas)
-            {
-                auto ptr = m_buckets[d.index].allocate(bytes);
-                if(ptr!=nullptr)
-                    return ptr;
-            }
+            std::array<std::uint8_t, bucket_count> order{};
+            for(std::size_t i{0}; i < bucket_count; ++i)
+                order[i] = static_cast<std::uint8_t>(deltas[i].index);
+            return order;
+        }
 
-            throw std::bad_alloc{};
+        /**
+         * @brief 
+         * The bucket order of every request size up to the largest block,
+         * computed at compile-time from the bucket descriptors.
+         */
+        static constexpr auto bucket_order_table = []{
+            std::array<std::array<std::uint8_t, bucket_count>, max_block_size + 1> table{};
+            for(std::size_t bytes{0}; bytes <= max_block_size; ++bytes)
+                table[bytes] = make_bucket_order(bytes);
+            return table;
+        }();
+
+        /**
+         * @brief 
+         * Requests up to the largest block size look their bucket order up
+         * in `bucket_order_table`, so the common path is a table load and
+         * one bucket allocation. Larger requests compute it.
+         */
+        void* allocate(std::size_t bytes){
+            if(bytes <= max_block_size)
+                return allocate_in_order(bucket_order_table[bytes], bytes);
+
+            return allocate_in_order(make_bucket_order(bytes), bytes);
         }
 
-        void deallocate(void* ptr, std::size_t bytes){
-            /*auto* it = std::find_if(m_buckets.begin(), m_buckets.end(),[&](Bucket element){
-                return element.belongs(ptr);
-            });*/
-            
-            int i{0};
-            for(i = 0;i<m_buckets.size();++i){
-                if(m_buckets[i].belongs(ptr))
-                    break;
-            }
+        /**
+         * @brief 
+         * The owning bucket is found from the address alone, and so is the
+         * size of the allocation: `bytes` is not needed, which lets callers
+         * that don't track accurate sizes free correctly.
+         */
+        void deallocate(void* ptr, [[maybe_unused]] std::size_t bytes){
+            deallocate(ptr);
+        }
 
-            if(i!=m_buckets.size())
-                m_buckets[i].deallocate(ptr,bytes);
+        /**
+         * @brief 
+         * Pointers from outside the pool are ignored.
+         */
+        void deallocate(void* ptr){
+            bucket_t* bucket = owner(ptr);
+            if(bucket != nullptr)
+                bucket->deallocate(ptr);
+        }
+
+        /**
+         * @brief 
+         * The bucket `ptr` was allocated from, or `nullptr`.
+         */
+        bucket_t* owner(void* ptr) noexcept{
+            const std::size_t index = bucket_index(ptr);
+            return (index == bucket_count) ? nullptr : &m_buckets[index];
+        }
+
+        /**
+         * @brief 
+         * Index of the bucket `ptr` was allocated from, or `bucket_count`.
+         * Only the buckets' bounds are read, so any thread may call it.
+         */
+        std::size_t bucket_index(void* ptr) const noexcept{
+            const auto offset = reinterpret_cast<std::uintptr_t>(ptr)
+                - reinterpret_cast<std::uintptr_t>(m_data);
+            const std::size_t index = offset >> slot_shift;
+            if(index >= bucket_count || !m_buckets[index].belongs(ptr))
+                return bucket_count;
+            return index;
+        }
+
+        bucket_t& get_bucket(std::size_t index) noexcept{
+            return m_buckets[index];
         }
 
         private:
-        std::array<Bucket,bucket_count> m_buckets;
+        /**
+         * @brief 
+         * The one range all buckets are carved out of, declared before the
+         * buckets so that it is allocated first.
+         */
+        std::byte* m_data;
+        std::array<bucket_t,bucket_count> m_buckets;
+
+        void* allocate_in_order(
+            const std::array<std::uint8_t, bucket_count>& order,
+            std::size_t bytes)
+        {
+            for(std::uint8_t index : order)
+            {
+                auto ptr = m_buckets[index].allocate(bytes);
+                if(ptr!=nullptr)
+                    return ptr;
+            }
+
+            throw std::bad_alloc{};
+        }
 
     };
 
@@ -0,0 +1,82 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include "order_id.h"
+#include "order_type.h"
+#include "usings.h"
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace dev {
+
+/**
+ * @brief A new order as submitted in a batch. The symbol is stored the same
+ * way as in @a OrderId: zero-padded, not NUL-terminated at 4 characters.
+ * @a stop_price is only used by STOP and STOP_LIMIT orders.
+ */
+struct OrderRequest
+{
+    char symbol_name[4];
+    UserId user_id;
+    OrderType order_type;
+    Side side;
+    Price price;
+    Quantity quantity;
+    Price stop_price;
+
+    std::string_view get_symbol_name() const
+    {
+        return { symbol_name, strnlen(symbol_name, sizeof(symbol_name)) };
+    }
+};
+
+enum class CommandType : uint8_t
+{
+    ADD_ORDER,
+    MODIFY_ORDER,
+    CANCEL_ORDER,
+};
+
+/**
+ * @brief One entry of a mixed-command batch.
+ *
+ * ADD_ORDER uses @a order_request. MODIFY_ORDER uses @a order_id, @a new_price
+ * and @a new_quantity. CANCEL_ORDER uses @a order_id.
+ */
+struct Command
+{
+    CommandType command_type;
+    OrderRequest order_request;
+    OrderId order_id;
+    Price new_price;
+    Quantity new_quantity;
+
+    std::string_view get_symbol_name() const
+    {
+        return command_type == CommandType::ADD_ORDER ? order_request.get_symbol_name()
+                                                      : order_id.get_symbol_name();
+    }
+};
+
+enum class CommandStatus : uint8_t
+{
+    ACCEPTED,
+    REJECTED,
+};
+
+/**
+ * @brief Outcome of one command of a batch. For ADD_ORDER, @a order_id is the
+ * id assigned to the order (seq_num 0 if it was dropped without trading).
+ */
+struct CommandResult
+{
+    CommandStatus status;
+    OrderId order_id;
+};
+
+static_assert(std::is_trivially_copyable_v<Command>);
+static_assert(std::is_trivially_copyable_v<CommandResult>);
+}
+#endif
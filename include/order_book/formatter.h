@@ -16,7 +16,7 @@ struct std::formatter<dev::TradeInfo> : std::formatter<std::string_view>
                                     t.fill_type == FillType::Full ? "Full" : "Partial",
                                     t.user_id,
                                     t.order_id.seq_num,
-                                    t.order_id.symbol_name,
+                                    t.order_id.get_symbol_name(),
                                     t.price,
                                     t.quantity);
         return std::formatter<std::string_view>::format(s, ctx);
@@ -29,7 +29,10 @@ struct std::formatter<dev::OrderId> : std::formatter<std::string_view>
     auto format(const dev::OrderId& order_id, auto& ctx) const
     {
         std::string s = std::format(
-          "OrderId{{SeqNum={}, symbol_name={}}}", order_id.seq_num, order_id.symbol_name);
+          "OrderId{{SeqNum={}, generation={}, symbol_name={}}}",
+          order_id.seq_num,
+          order_id.generation,
+          order_id.get_symbol_name());
         return std::formatter<std::string_view>::format(s, ctx);
     }
 };
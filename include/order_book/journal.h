@@ -0,0 +1,117 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+namespace dev {
+class OrderEntryDecoder;
+
+/**
+ * @brief Static parameters of a @a Journal.
+ *
+ * The file is sized for `capacity` bytes of messages when it is created.
+ * If `flush_interval` is set, a background thread writes the new messages to
+ * disk at that interval; otherwise they reach the disk when the caller calls
+ * @a flush or the kernel writes the pages back.
+ */
+struct JournalConfig
+{
+    std::size_t capacity{ std::size_t{ 1 } << 30 };
+    std::optional<std::chrono::microseconds> flush_interval{ 1000 };
+};
+
+/**
+ * @brief A @a Journal is an append-only log of the order-entry messages
+ * received by the engine, kept in a pre-allocated, memory-mapped file.
+ *
+ * Appending is a copy into the mapping followed by a release store of the new
+ * end of the log in the file header: no system call, no allocation. Since the
+ * mapping is shared, what was appended survives a crash of the process; the
+ * flush thread (or @a flush) bounds what an operating system crash can lose.
+ * Message @a n of the log has sequence number @a n, counting from 1.
+ *
+ * Replaying the messages through an @a OrderEntryDecoder rebuilds the books:
+ * messages are decoded in place from the mapping, and order ids come out the
+ * same since the books see the same commands in the same order. Rejected
+ * requests are journaled too, and rejected again on replay. Expiry by time
+ * is journaled as EXPIRE_ORDERS messages, see OrderEntryDecoder::expire_orders,
+ * so expired orders leave the books at the same point of the replay; the books
+ * must be built with the same @a OrderBookConfig.
+ *
+ * A flush failing on the flush thread is kept and rethrown by the next
+ * @a append, and the thread stops flushing.
+ */
+class Journal
+{
+  public:
+    static constexpr uint64_t magic = 0x4c4e524a4b4f4f42; // "BOOKJRNL"
+    static constexpr uint32_t version = 1;
+
+    // Constructors
+    explicit Journal(const std::string& path,
+                     const JournalConfig& config = JournalConfig{});
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+    ~Journal();
+
+    // Getters
+    uint64_t get_sequence_number() const;
+    uint64_t get_flushed_sequence_number() const;
+    std::size_t get_size() const;
+    std::size_t get_capacity() const;
+
+    // Modifiers
+    uint64_t append(std::span<const std::byte> message);
+    void flush();
+    uint64_t replay(OrderEntryDecoder& decoder, uint64_t after_sequence_number = 0);
+
+  private:
+    struct alignas(64) FileHeader
+    {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t capacity;
+        // Bytes of messages written, published after the messages themselves
+        uint64_t size;
+    };
+
+    int m_fd;
+    std::byte* m_mapping;
+    std::size_t m_mapping_size;
+    FileHeader* m_header;
+    std::byte* m_data;
+    std::size_t m_capacity;
+
+    // Owned by the appending thread
+    std::size_t m_size;
+    std::atomic<uint64_t> m_sequence_number;
+
+    // Serializes flush calls from the flush thread and the caller
+    std::mutex m_flush_mutex;
+    std::size_t m_flushed_size;
+    std::atomic<uint64_t> m_flushed_sequence_number;
+    // Set by the flush thread, and published by m_has_flush_error, when a
+    // flush fails
+    std::exception_ptr m_flush_error;
+    std::atomic<bool> m_has_flush_error;
+
+    // Declared last so that it is started after and joined before the
+    // members it uses are destroyed.
+    std::jthread m_flusher;
+
+    std::size_t next_message(std::size_t offset) const;
+    void run_flusher(std::stop_token stop_token, std::chrono::microseconds interval);
+};
+}
+#endif
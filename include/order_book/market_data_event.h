@@ -0,0 +1,51 @@
+#ifndef MARKET_DATA_EVENT_H
+#define MARKET_DATA_EVENT_H
+
+#include "order_id.h"
+#include "spsc_queue.h"
+#include "usings.h"
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace dev {
+
+enum class MarketDataEventType : uint8_t
+{
+    // L3: one resting order
+    ORDER_ADDED,
+    ORDER_CANCELLED,
+    ORDER_MODIFIED,
+    ORDER_EXECUTED,
+    // L2: aggregate of one price level
+    LEVEL_CHANGED
+};
+
+/**
+ * @brief One incremental change of an @a OrderBook.
+ *
+ * For L3 events, @a order_id identifies the resting order and @a quantity is
+ * its open quantity after the change, or the fill quantity of ORDER_EXECUTED.
+ * For LEVEL_CHANGED, @a quantity and @a order_count are the new totals of the
+ * level at @a price; a level with zero orders has been removed.
+ *
+ * @a seq_num is assigned per book and increases by one for every event, so a
+ * consumer detects a dropped event as a gap.
+ */
+struct MarketDataEvent
+{
+    uint64_t seq_num;
+    MarketDataEventType event_type;
+    Side side;
+    OrderId order_id;
+    Price price;
+    Quantity quantity;
+    std::size_t order_count;
+};
+
+static_assert(std::is_trivially_copyable_v<MarketDataEvent>);
+
+using MarketDataQueue = SpscQueue<MarketDataEvent, 1u << 14>;
+}
+
+#endif
@@ -1,28 +1,43 @@
 #ifndef MARKET_DATA_MANAGER_H
 #define MARKET_DATA_MANAGER_H
 
+#include "command.h"
 #include "order_book.h"
+#include "order_book_config.h"
 #include "order_type.h"
+#include "symbol_directory.h"
+#include "trade_listener.h"
+#include "user_registry.h"
 #include "usings.h"
 #include <cassert>
 #include <format>
 #include <memory>
 #include <optional>
+#include <span>
 #include <stdexcept>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 namespace dev {
 /**
  * @brief The MarketDataManager is an orchestrator that manages symbols,
  * order books and orders.
+ *
+ * Each symbol is given a dense @a SymbolId by the symbol directory when it is
+ * onboarded, and its book lives at that index of a fixed array sized for
+ * @a max_symbols books, so books never move once created.
+ *
+ * User names are interned into the manager's own @a UserRegistry, or into one
+ * shared with other managers, e.g. the shards of a @a ShardedEngine, if given.
  */
 class MarketDataManager
 {
   public:
     // Constructors
-    MarketDataManager();
+    explicit MarketDataManager(
+      const OrderBookConfig& config = OrderBookConfig{},
+      std::size_t max_symbols = SymbolDirectory::default_capacity,
+      UserRegistry* user_registry = nullptr);
     MarketDataManager(const MarketDataManager&) = delete;
     MarketDataManager& operator=(const MarketDataManager&) = delete;
     MarketDataManager(MarketDataManager&&) = delete;
@@ -31,34 +46,79 @@ class MarketDataManager
     // Public API
     // Getters
     OrderBook& get_order_book(std::string_view symbol_name);
+    OrderBook& get_order_book(SymbolId symbol_id);
+    SymbolDirectory& get_symbol_directory();
     Order& get_order(OrderId order_id);
+    UserRegistry& get_user_registry();
 
     // Modifiers
-    void add_order(OrderType order_type,
-                   UserId user_id,
-                   Side side,
-                   std::string_view symbol_name,
-                   Price price,
-                   Quantity quantity);
+    SymbolId add_symbol(std::string_view symbol_name);
+    OrderId add_order(OrderType order_type,
+                      UserId user_id,
+                      Side side,
+                      std::string_view symbol_name,
+                      Price price,
+                      Quantity quantity);
+    OrderId add_order(OrderType order_type,
+                      std::string_view user_name,
+                      Side side,
+                      std::string_view symbol_name,
+                      Price price,
+                      Quantity quantity);
+    OrderId add_stop_order(OrderType order_type,
+                           UserId user_id,
+                           Side side,
+                           std::string_view symbol_name,
+                           Price stop_price,
+                           Price price,
+                           Quantity quantity);
     void modify_order(OrderId order_id, Price new_price, Quantity new_quantity);
     void cancel_order(OrderId order_id);
+    std::size_t mass_cancel(std::string_view symbol_name,
+                            UserId user_id,
+                            std::optional<Side> side = std::nullopt);
+    void set_trade_listener(TradeListener* trade_listener);
+    void set_session_close_time(Timestamp session_close_time);
+    std::size_t expire_orders(Timestamp now, std::size_t max_orders);
+
+    // Snapshots
+    void save_snapshot(const std::string& path, uint64_t sequence_number);
+    uint64_t load_snapshot(const std::string& path);
+
+    // Batch API
+    void add_orders(std::span<const OrderRequest> order_requests,
+                    std::span<CommandResult> results);
+    void cancel_orders(std::span<const OrderId> order_ids,
+                       std::span<CommandResult> results);
+    void process_commands(std::span<const Command> commands,
+                          std::span<CommandResult> results);
 
   private:
-    // Constant-time access to orderbook
-    std::unordered_map<size_t, OrderBook> m_order_books;
+    // Configuration of newly created order books
+    OrderBookConfig m_config;
 
-    // Getters
-    std::unordered_map<size_t, OrderBook>& get_order_books();
-    auto get_order_book_iter(std::string_view symbol_name);
+    // Listener attached to every order book, not owned
+    TradeListener* m_trade_listener;
 
-    // Modifiers
-    void add_order_book(std::string_view symbol_name);
-    void delete_order_book(std::string_view symbol_name);
+    // Registry created when none is shared with the manager
+    std::unique_ptr<UserRegistry> m_owned_user_registry;
+
+    // User names interned into UserId handles, possibly shared
+    UserRegistry* m_user_registry;
+
+    // Symbols onboarded so far, indexing m_order_books
+    SymbolDirectory m_symbol_directory;
+
+    // One slot per SymbolId, engaged once the symbol is onboarded
+    std::unique_ptr<std::optional<OrderBook>[]> m_order_books;
+
+    // Getters
+    OrderBook* find_order_book(std::string_view symbol_name, bool create);
+    OrderBook* try_find_order_book(std::string_view symbol_name, bool create);
 };
-// Ingestion Thread that reads data from the socket
-// OrderBook -> PruneDayOrders
+// Ingestion Thread that reads data from the socket, see FdIngestor
 // Main thread - MarketDataManager
 // Enqueue trades filled into -> MPMC Lock-free queue -> Publisher thread Market
-// dissemination
+// dissemination, see TradePublisher
 }
 #endif
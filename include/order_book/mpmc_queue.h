@@ -0,0 +1,145 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include "usings.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <span>
+
+namespace dev {
+
+/**
+ * @brief A bounded, lock-free, multi-producer multi-consumer ring buffer
+ * (Vyukov's algorithm).
+ *
+ * Every slot carries a sequence number telling producers and consumers whose
+ * turn it is, so that each side only contends on its own position counter
+ * with a single compare-and-swap. Slots are padded to whole cache lines so
+ * that a producer and a consumer working on neighbouring slots do not share a
+ * line. All slots are allocated up-front; no operation allocates or blocks.
+ *
+ * @tparam T Element type, copied into and out of pre-constructed slots.
+ * @tparam Capacity Number of slots, must be a power of two.
+ */
+template<typename T, std::size_t Capacity>
+class MpmcQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "MpmcQueue capacity must be a power of two");
+
+  public:
+    MpmcQueue()
+      : m_slots{ std::make_unique<Slot[]>(Capacity) }
+    {
+        for (std::size_t i{ 0 }; i < Capacity; ++i)
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    /**
+     * @brief Any producer. Returns false if the queue is full.
+     */
+    bool try_push(const T& value)
+    {
+        std::size_t position = m_enqueue_position.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = m_slots[position & (Capacity - 1)];
+            std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence - position);
+            if (diff == 0) {
+                if (m_enqueue_position.compare_exchange_weak(
+                      position, position + 1, std::memory_order_relaxed)) {
+                    slot.value = value;
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                position = m_enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Any consumer. Returns false if the queue is empty.
+     */
+    bool try_pop(T& value) { return try_pop_batch(std::span<T>(&value, 1)) == 1; }
+
+    /**
+     * @brief Any consumer. Claim up to `values.size()` consecutive ready
+     * elements with a single compare-and-swap and copy them into @a values.
+     * Returns the number of elements popped, 0 if the queue is empty.
+     */
+    std::size_t try_pop_batch(std::span<T> values)
+    {
+        if (values.empty())
+            return 0;
+
+        std::size_t position = m_dequeue_position.load(std::memory_order_relaxed);
+        std::size_t count{ 0 };
+        while (true) {
+            // Count the published slots from position onwards
+            count = 0;
+            while (count < values.size()) {
+                const Slot& slot = m_slots[(position + count) & (Capacity - 1)];
+                std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                if (sequence != position + count + 1)
+                    break;
+                ++count;
+            }
+
+            if (count == 0) {
+                const Slot& slot = m_slots[position & (Capacity - 1)];
+                std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                if (static_cast<std::ptrdiff_t>(sequence - (position + 1)) < 0)
+                    return 0;
+
+                // Another consumer got there first
+                position = m_dequeue_position.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            if (m_dequeue_position.compare_exchange_weak(
+                  position, position + count, std::memory_order_relaxed))
+                break;
+        }
+
+        for (std::size_t i{ 0 }; i < count; ++i) {
+            Slot& slot = m_slots[(position + i) & (Capacity - 1)];
+            values[i] = slot.value;
+            slot.sequence.store(position + i + Capacity, std::memory_order_release);
+        }
+        return count;
+    }
+
+    /**
+     * @brief Approximate number of queued elements.
+     */
+    std::size_t size() const
+    {
+        std::size_t enqueue_position = m_enqueue_position.load(std::memory_order_acquire);
+        std::size_t dequeue_position = m_dequeue_position.load(std::memory_order_acquire);
+        return enqueue_position > dequeue_position ? enqueue_position - dequeue_position
+                                                   : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+  private:
+    struct alignas(cache_line_size) Slot
+    {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    alignas(cache_line_size) std::atomic<std::size_t> m_enqueue_position{ 0u };
+    alignas(cache_line_size) std::atomic<std::size_t> m_dequeue_position{ 0u };
+    alignas(cache_line_size) std::unique_ptr<Slot[]> m_slots;
+};
+}
+#endif
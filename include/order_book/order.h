@@ -9,20 +9,28 @@
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <utility>
 
 namespace dev {
 
-// Data-oriented design
+// Data-oriented design: an Order is a plain trivially-copyable record that fits
+// in a single cache line. Fields are ordered by decreasing alignment to avoid
+// padding; the owner is an interned UserId, resolved to a name on publication.
+// @a stop_price is the trigger price of a STOP or STOP_LIMIT order, 0 otherwise.
 struct Order
 {
-    OrderType order_type;
     OrderId order_id;
     UserId user_id;
+    OrderType order_type;
     Side side;
     Price price;
     Quantity initial_quantity;
     Quantity remaining_quantity;
+    Price stop_price;
 };
+
+static_assert(std::is_trivially_copyable_v<Order>);
+static_assert(sizeof(Order) <= cache_line_size);
 }
 #endif
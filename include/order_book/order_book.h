@@ -1,10 +1,17 @@
 #ifndef ORDER_BOOK_H
 #define ORDER_BOOK_H
 
+#include "command.h"
+#include "market_data_event.h"
+#include "order_book_config.h"
 #include "order_node.h"
+#include "order_pool.h"
+#include "price_ladder.h"
 #include "price_level.h"
+#include "timer_wheel.h"
 #include "trade.h"
 #include "trade_info.h"
+#include "trade_listener.h"
 #include "usings.h"
 #include <algorithm>
 #include <chrono>
@@ -14,14 +21,16 @@
 #include <list>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string_view>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace dev {
 
 class MarketDataManager; // forward declaration (avoid including manager header)
+class SnapshotReader;
+class SnapshotWriter;
 
 using Trades = std::vector<Trade>;
 using PriceLevels = std::vector<PriceLevel>;
@@ -38,65 +47,141 @@ class OrderBook
 
   public:
     // Constructors and assignment operators
-    explicit OrderBook();
-    // void swap(OrderBook& other);
-    // OrderBook(OrderBook&& other);
-    // OrderBook& operator=(OrderBook&&);
+    // Price levels hold a reference to their book, so books are pinned in memory.
+    explicit OrderBook(const OrderBookConfig& config = OrderBookConfig{});
+    OrderBook(const OrderBook&) = delete;
+    OrderBook& operator=(const OrderBook&) = delete;
+    OrderBook(OrderBook&&) = delete;
+    OrderBook& operator=(OrderBook&&) = delete;
 
     // Getters
     Order& get_order(OrderId order_id);
-    PriceLevels& get_bids();
-    PriceLevels& get_asks();
-    PriceLevels& get_price_levels(LevelType level_type);
+    PriceLadder& get_bids();
+    PriceLadder& get_asks();
+    PriceLadder& get_price_levels(LevelType level_type);
+    PriceLadder& get_stop_levels(Side side);
+    std::optional<Price> get_last_trade_price() const;
     PriceLevel& get_best_bid();
     PriceLevel& get_best_ask();
     const PriceLevel& get_best_bid() const;
     const PriceLevel& get_best_ask() const;
 
-    auto get_price_level_iter(LevelType level_type, Price price);
     PriceLevel& get_bid_price_level(Price price);
     PriceLevel& get_ask_price_level(Price price);
     PriceLevel& get_price_level(LevelType level_type, Price price);
-    std::deque<SeqNum>& get_free_list();
+    OrderPool& get_order_pool();
+    TradeListener* get_trade_listener();
+    MarketDataQueue* get_market_data_queue();
+    uint64_t get_dropped_event_count() const;
+    uint64_t get_expiry_work_done() const;
+
+    // Market depth
+    std::size_t get_depth(LevelType level_type, std::span<DepthLevel> depth_levels);
+    Quantity get_cumulative_quantity(LevelType level_type, Price price);
+    std::optional<double> get_average_fill_price(Side side, Quantity quantity);
 
     bool is_match_possible(Side side, Price price);
+    bool has_liquidity(Side side, Price price, Quantity quantity);
+    bool has_expired_orders(Timestamp now) const;
     bool order_exists(OrderId order_id);
 
     // Modifiers
-    void add_order(OrderType order_type,
-                   UserId user_id,
-                   Side side,
-                   std::string_view symbol_name,
-                   Price price,
-                   Quantity quantity);
+    OrderId add_order(OrderType order_type,
+                      UserId user_id,
+                      Side side,
+                      std::string_view symbol_name,
+                      Price price,
+                      Quantity quantity);
+    OrderId add_stop_order(OrderType order_type,
+                           UserId user_id,
+                           Side side,
+                           std::string_view symbol_name,
+                           Price stop_price,
+                           Price price,
+                           Quantity quantity);
     void modify_order(OrderId order_id, Price new_price, Quantity new_quantity);
     void cancel_order(OrderId order_id);
+    std::size_t mass_cancel(UserId user_id, std::optional<Side> side = std::nullopt);
+    void add_orders(std::span<const OrderRequest> order_requests,
+                    std::span<CommandResult> results);
+    void cancel_orders(std::span<const OrderId> order_ids,
+                       std::span<CommandResult> results);
+    void process_commands(std::span<const Command> commands,
+                          std::span<CommandResult> results);
     void match();
-    void add_price_level(LevelType level_type, Price price);
-    void delete_price_level(LevelType level_type, Price price);
+    void set_trade_listener(TradeListener* trade_listener);
+    void set_market_data_queue(MarketDataQueue* market_data_queue);
+    void set_auction_mode(bool is_auction_mode);
+
+    // Expiry
+    void set_session_close_time(Timestamp session_close_time);
+    void schedule_expiry(OrderId order_id, Timestamp expire_time);
+    std::size_t expire_orders(Timestamp now, std::size_t max_orders);
+
+    // Snapshots
+    void save_snapshot(SnapshotWriter& writer) const;
+    void load_snapshot(SnapshotReader& reader);
 
     SeqNum get_next_seq_num();
     OrderId generate_order_id(std::string_view symbol_name);
 
   private:
-    // All incoming orders are stored sequentially in an order_pool.
-    // The order_pool is a pre-allocated buffer and consists of OrderNodes.
-    std::vector<OrderNode> m_order_pool;
-
-    // List of free indices
-    std::deque<SeqNum> m_free_list;
-
-    // Buy orders sorted by price (highest first)
-    std::vector<PriceLevel> m_bids;
-    // Sell orders sorted by price (lowest first)
-    std::vector<PriceLevel> m_asks;
-
-    PriceLevels::iterator find_insert_location(PriceLevels& price_levels,
-                                               LevelType level_type,
-                                               Price price);
+    // All resting orders are stored in the order_pool, which consists of
+    // OrderNodes and threads its free list through the unused ones.
+    OrderPool m_order_pool;
+
+    // Buy orders indexed by price tick (best is the highest)
+    PriceLadder m_bids;
+    // Sell orders indexed by price tick (best is the lowest)
+    PriceLadder m_asks;
+
+    // Pending stop orders indexed by stop price tick (best is the first to
+    // trigger: the lowest buy stop and the highest sell stop). Stops hold few
+    // prices, so their levels are allocated on first use
+    PriceLadder m_buy_stops;
+    PriceLadder m_sell_stops;
+    std::optional<Price> m_last_trade_price;
+
+    // Notified synchronously of every fill, not owned
+    TradeListener* m_trade_listener;
+
+    // Receives the incremental market data feed, not owned
+    MarketDataQueue* m_market_data_queue;
+    // Sequence number of the last event and number of events lost to a
+    // full queue
+    uint64_t m_event_seq_num;
+    uint64_t m_dropped_event_count;
+
+    // When set, add_order rests orders without matching them
+    bool m_is_auction_mode;
+
+    // Resting orders indexed by expiry time, and the expiry of GOOD_FOR_DAY
+    // orders
+    TimerWheel m_expiry_wheel;
+    std::optional<Timestamp> m_session_close_time;
+
+    void process_order(Order& order);
+    void modify_stop_order(Order& order, Price new_price, Quantity new_quantity);
+    void trigger_stops();
+    void match_aggressor(Order& aggressor);
+    static bool is_immediate(OrderType order_type);
+    static bool is_pending_stop(const Order& order);
+    CommandResult try_add_order(const OrderRequest& order_request);
+    CommandResult try_modify_order(OrderId order_id,
+                                   Price new_price,
+                                   Quantity new_quantity);
+    CommandResult try_cancel_order(OrderId order_id);
+    static TradeInfo make_fill_info(const Order& order,
+                                    Price price,
+                                    Quantity fill_quantity);
+    void publish_trade(const TradeInfo& executing_order,
+                       const TradeInfo& reducing_order);
+    void publish_order_event(MarketDataEventType event_type,
+                             const Order& order,
+                             Price price,
+                             Quantity quantity);
+    void publish_level_event(const PriceLevel& price_level);
 };
-
-using OrderBooks = std::unordered_map<size_t, OrderBook>;
 } // namespace dev
 
 #endif
@@ -0,0 +1,35 @@
+#ifndef ORDER_BOOK_CONFIG_H
+#define ORDER_BOOK_CONFIG_H
+
+#include "usings.h"
+#include <cstddef>
+#include <optional>
+
+namespace dev {
+
+/**
+ * @brief Static parameters of an @a OrderBook.
+ *
+ * The book quotes on a fixed tick grid: the valid prices are
+ * `base_price + k * tick_size` for `k` in `[0, num_ticks)`.
+ *
+ * The order pool is pre-faulted for `order_pool_capacity` resting orders at
+ * construction and grows by whole segments beyond that.
+ *
+ * GOOD_FOR_DAY orders expire at `session_close_time`, if set. The expiry wheel
+ * starts at `start_time`, which should be close to the first timestamp the book
+ * sees: expiries in a later period of 2^30 ticks than the wheel's time wait in
+ * an overflow list, which is scanned once per period that holds one.
+ */
+struct OrderBookConfig
+{
+    Price base_price{ 0u };
+    Price tick_size{ 1u };
+    std::size_t num_ticks{ 1u << 14 };
+    std::size_t order_pool_capacity{ 10000u };
+    std::optional<Timestamp> session_close_time{};
+    Timestamp start_time{ 0u };
+};
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef ORDER_ENTRY_DECODER_H
+#define ORDER_ENTRY_DECODER_H
+
+#include "market_data_manager.h"
+#include "order_entry_protocol.h"
+#include "order_id.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+namespace dev {
+class Journal;
+
+/**
+ * @brief An @a OrderEntryDecoder applies a stream of order-entry messages to a
+ * @a MarketDataManager.
+ *
+ * Messages are read in place from the caller's buffer, without copying or
+ * allocating, and turned directly into manager calls. Requests with invalid
+ * fields (an unknown order type or side, a zero quantity, a user id the
+ * manager's registry has not handed out) or that the manager rejects (unknown
+ * orders, prices off the ladder, ...) are counted and the stream goes on; a
+ * malformed header means the stream cannot be framed any more and throws.
+ * With a @a Journal attached, every well-framed message is appended to it
+ * before it is applied, rejected requests included, so that a replay goes
+ * through the same requests.
+ *
+ * Expiry by time must go through @a expire_orders rather than straight to the
+ * manager, so that it is journaled in sequence with the other requests.
+ */
+class OrderEntryDecoder
+{
+  public:
+    explicit OrderEntryDecoder(MarketDataManager& market_data_manager);
+    OrderEntryDecoder(const OrderEntryDecoder&) = delete;
+    OrderEntryDecoder& operator=(const OrderEntryDecoder&) = delete;
+
+    // Getters
+    uint64_t get_message_count() const;
+    uint64_t get_reject_count() const;
+    OrderId get_last_order_id() const;
+
+    // Modifiers
+    void set_journal(Journal* journal);
+    std::size_t decode(std::span<const std::byte> bytes);
+    std::size_t expire_orders(Timestamp now, std::size_t max_orders);
+
+  private:
+    MarketDataManager& m_market_data_manager;
+    uint64_t m_message_count;
+    uint64_t m_reject_count;
+
+    // Id assigned to the last new order, so that a client can address it
+    OrderId m_last_order_id;
+    // Orders cancelled by the last EXPIRE_ORDERS message
+    std::size_t m_expired_count;
+
+    // Log of the received messages, not owned
+    Journal* m_journal;
+
+    bool apply(const MessageHeader& header);
+    bool on_message(const NewOrderMessage& message);
+    bool on_message(const CancelOrderMessage& message);
+    bool on_message(const ModifyOrderMessage& message);
+    bool on_message(const MassCancelMessage& message);
+    bool on_message(const ExpireOrdersMessage& message);
+};
+
+/**
+ * @brief An @a FdIngestor reads order-entry messages from a file descriptor
+ * (a pipe, a TCP socket, ...) into a pre-allocated buffer and feeds them to a
+ * decoder.
+ *
+ * Each read asks for all the free space of the buffer so that one system call
+ * brings in as many messages as are available. A message split across reads
+ * is moved to the front of the buffer and completed by the next read.
+ */
+class FdIngestor
+{
+  public:
+    static constexpr std::size_t default_buffer_size = 1u << 16;
+
+    FdIngestor(int fd,
+               OrderEntryDecoder& decoder,
+               std::size_t buffer_size = default_buffer_size);
+    FdIngestor(const FdIngestor&) = delete;
+    FdIngestor& operator=(const FdIngestor&) = delete;
+
+    // Getters
+    uint64_t get_read_count() const;
+    uint64_t get_byte_count() const;
+
+    // Modifiers
+    bool poll_once();
+    void run();
+
+  private:
+    int m_fd;
+    OrderEntryDecoder& m_decoder;
+    std::size_t m_buffer_size;
+    std::unique_ptr<std::byte[]> m_buffer;
+
+    // Bytes of an incomplete message at the front of m_buffer
+    std::size_t m_pending_size;
+    uint64_t m_read_count;
+    uint64_t m_byte_count;
+};
+}
+#endif
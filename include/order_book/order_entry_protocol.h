@@ -0,0 +1,128 @@
+#ifndef ORDER_ENTRY_PROTOCOL_H
+#define ORDER_ENTRY_PROTOCOL_H
+
+#include "command.h"
+#include "order_id.h"
+#include "usings.h"
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace dev {
+
+/**
+ * @brief Binary order-entry protocol.
+ *
+ * Every message is a fixed-layout, trivially copyable struct starting with a
+ * @a MessageHeader, in host byte order. Message sizes are multiples of 8 bytes,
+ * so in a stream that starts 8-byte aligned every message is aligned too and
+ * is read in place from the receive buffer.
+ */
+enum class MessageType : uint8_t
+{
+    NEW_ORDER = 1,
+    CANCEL_ORDER,
+    MODIFY_ORDER,
+    MASS_CANCEL,
+    EXPIRE_ORDERS,
+};
+
+struct MessageHeader
+{
+    // Size of the whole message, header included
+    uint16_t length;
+    MessageType message_type;
+    uint8_t reserved;
+};
+
+/**
+ * @brief A new order. STOP and STOP_LIMIT orders use @a stop_price of the
+ * request.
+ */
+struct NewOrderMessage
+{
+    static constexpr MessageType message_type = MessageType::NEW_ORDER;
+
+    MessageHeader header;
+    uint32_t reserved;
+    OrderRequest order_request;
+};
+
+struct CancelOrderMessage
+{
+    static constexpr MessageType message_type = MessageType::CANCEL_ORDER;
+
+    MessageHeader header;
+    OrderId order_id;
+};
+
+struct ModifyOrderMessage
+{
+    static constexpr MessageType message_type = MessageType::MODIFY_ORDER;
+
+    MessageHeader header;
+    OrderId order_id;
+    Price new_price;
+    Quantity new_quantity;
+};
+
+/**
+ * @brief Cancel every order of @a user_id in @a symbol_name, on @a side only
+ * unless it is 0.
+ */
+struct MassCancelMessage
+{
+    static constexpr MessageType message_type = MessageType::MASS_CANCEL;
+
+    MessageHeader header;
+    char symbol_name[4];
+    UserId user_id;
+    Side side;
+    uint8_t reserved[3];
+};
+
+/**
+ * @brief Expire the orders due at or before @a now, doing at most @a max_orders
+ * units of expiry work, see MarketDataManager::expire_orders. Journaled like
+ * any other request so that a replay expires the same orders at the same point
+ * of the stream.
+ */
+struct ExpireOrdersMessage
+{
+    static constexpr MessageType message_type = MessageType::EXPIRE_ORDERS;
+
+    MessageHeader header;
+    uint32_t reserved;
+    Timestamp now;
+    uint64_t max_orders;
+};
+
+/**
+ * @brief The header of a @a Message.
+ */
+template<typename Message>
+constexpr MessageHeader
+make_header()
+{
+    return MessageHeader{ .length = sizeof(Message),
+                          .message_type = Message::message_type,
+                          .reserved = 0 };
+}
+
+static_assert(sizeof(MessageHeader) == 4);
+static_assert(sizeof(NewOrderMessage) == 48);
+static_assert(sizeof(CancelOrderMessage) == 16);
+static_assert(sizeof(ModifyOrderMessage) == 32);
+static_assert(sizeof(MassCancelMessage) == 16);
+static_assert(sizeof(ExpireOrdersMessage) == 24);
+static_assert(std::is_trivially_copyable_v<NewOrderMessage>);
+static_assert(std::is_trivially_copyable_v<CancelOrderMessage>);
+static_assert(std::is_trivially_copyable_v<ModifyOrderMessage>);
+static_assert(std::is_trivially_copyable_v<MassCancelMessage>);
+static_assert(std::is_trivially_copyable_v<ExpireOrdersMessage>);
+
+// Largest message, the receive buffer must hold at least one
+inline constexpr std::size_t max_message_size = sizeof(NewOrderMessage);
+inline constexpr std::size_t message_alignment = 8;
+}
+#endif
@@ -2,16 +2,33 @@
 #define ORDERID_H
 
 #include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
 
 namespace dev {
 using SymbolName = char[4];
 
+/**
+ * @brief Handle to an order: the symbol, the order pool slot (@a seq_num) and
+ * the slot's generation when the order was created, so that handles to a
+ * reused slot can be told apart.
+ */
 struct OrderId
 {
     char symbol_name[4];
     uint32_t seq_num;
+    uint32_t generation;
+
+    /**
+     * @brief The symbol is stored zero-padded and is not NUL-terminated
+     * when it is exactly 4 characters long.
+     */
+    std::string_view get_symbol_name() const
+    {
+        return { symbol_name, strnlen(symbol_name, sizeof(symbol_name)) };
+    }
 };
 }
 
-#endif
\ No newline at end of file
+#endif
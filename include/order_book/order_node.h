@@ -2,18 +2,25 @@
 #define ORDERNODE_H
 
 #include "order.h"
-#include <optional>
-#include <vector>
+#include "usings.h"
+#include <type_traits>
 
 namespace dev {
 
+/**
+ * @brief A slot of the order pool. While the slot is in use, @a prev and
+ * @a next link it into its price level's queue. While it is free, @a prev
+ * holds the free marker and @a next threads the pool's free list. The slot's
+ * generation lives in @a order.order_id and survives the slot being freed.
+ */
 struct OrderNode
 {
-    std::optional<Order> order;
-    size_t prev, next;
+    Order order;
+    SeqNum prev, next;
 };
 
-using OrderPool = std::vector<OrderNode>;
+static_assert(std::is_trivially_copyable_v<OrderNode>);
+static_assert(sizeof(OrderNode) <= cache_line_size);
 }
 
-#endif
\ No newline at end of file
+#endif
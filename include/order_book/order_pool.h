@@ -0,0 +1,82 @@
+#ifndef ORDER_POOL_H
+#define ORDER_POOL_H
+
+#include "order_id.h"
+#include "order_node.h"
+#include "usings.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace dev {
+class SnapshotReader;
+class SnapshotWriter;
+
+/**
+ * @brief An @a OrderPool is the storage for all the orders of an @a OrderBook.
+ *
+ * Slots are addressed by @a SeqNum; slot 0 is a sentinel that stands for "no
+ * node" in the price level links. Free slots are chained through their own
+ * @a next link (an intrusive free list), so acquiring and releasing a slot is
+ * O(1) and allocation-free once the pool has warmed up.
+ *
+ * Every slot carries a generation counter, bumped each time it is released and
+ * copied into the @a OrderId handed out for it. A stale @a OrderId that refers to
+ * a since-reused slot is therefore rejected in O(1). An acquired slot only
+ * becomes live once an order is linked into it, so that the id of an aggressor
+ * being matched does not resolve to the slot's previous order.
+ *
+ * Slots live in fixed-size segments addressed by `seq_num >> segment_shift`.
+ * Growing the pool appends a segment and never moves existing nodes, so
+ * references to orders stay valid for the lifetime of the order. The segments
+ * covering the requested capacity are allocated and written to up-front, so
+ * that the first orders of the session do not take page faults.
+ */
+class OrderPool
+{
+  public:
+    // Stored in OrderNode::prev of free slots
+    static constexpr SeqNum free_marker = static_cast<SeqNum>(-1);
+
+    static constexpr std::size_t segment_shift = 12;
+    static constexpr std::size_t segment_size = std::size_t{ 1 } << segment_shift;
+    static constexpr std::size_t segment_mask = segment_size - 1;
+
+    // Constructors
+    explicit OrderPool(std::size_t capacity);
+    OrderPool(const OrderPool&) = delete;
+    OrderPool& operator=(const OrderPool&) = delete;
+
+    // Getters
+    OrderNode& operator[](SeqNum seq_num);
+    const OrderNode& operator[](SeqNum seq_num) const;
+    bool is_live(OrderId order_id) const;
+    uint32_t get_generation(SeqNum seq_num) const;
+    std::size_t size() const;
+    std::size_t capacity() const;
+    std::size_t get_live_count() const;
+
+    // Modifiers
+    SeqNum acquire();
+    void release(SeqNum seq_num);
+
+    // Snapshots
+    void save_snapshot(SnapshotWriter& writer) const;
+    void load_snapshot(SnapshotReader& reader);
+
+  private:
+    std::vector<std::unique_ptr<OrderNode[]>> m_segments;
+
+    // Number of slots created so far, including the sentinel
+    std::size_t m_size;
+
+    // Head of the intrusive free list, 0 when empty
+    SeqNum m_free_head;
+    std::size_t m_live_count;
+
+    void add_segment();
+};
+}
+
+#endif
@@ -1,15 +1,16 @@
 #ifndef ORDER_TYPE_H
 #define ORDER_TYPE_H
 
+#include <cstdint>
 #include <iostream>
 
 namespace dev {
-enum class OrderType
+enum class OrderType : uint8_t
 {
     MARKET,
     LIMIT,
-    // STOP,
-    // STOP_LIMIT,
+    STOP,
+    STOP_LIMIT,
     FILL_AND_KILL,
     FILL_OR_KILL,
     GOOD_FOR_DAY,
@@ -0,0 +1,100 @@
+#ifndef PRICE_LADDER_H
+#define PRICE_LADDER_H
+
+#include "order_book_config.h"
+#include "price_level.h"
+#include "usings.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dev {
+
+class OrderBook;
+class SnapshotReader;
+class SnapshotWriter;
+
+/**
+ * @brief A @a PriceLadder is one side of the book stored as an array of price
+ * levels, one per tick, indexed by `(price - base_price) / tick_size`.
+ *
+ * An occupancy bitmap with one bit per level (and a summary bitmap with one bit
+ * per occupancy word) tracks the non-empty levels, so that inserting, looking up
+ * and removing a level are O(1) and the next best level is found with a couple
+ * of word scans.
+ *
+ * The levels are stored in blocks of 64, one per occupancy word. A lazy ladder
+ * allocates a block when a price in it is first used rather than up front, for
+ * sides such as stop triggers that hold a few prices of a wide grid.
+ */
+class PriceLadder
+{
+  public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    // Constructors
+    PriceLadder(LevelType level_type,
+                const OrderBookConfig& config,
+                OrderBook& order_book,
+                bool is_lazy = false);
+    PriceLadder(const PriceLadder&) = delete;
+    PriceLadder& operator=(const PriceLadder&) = delete;
+
+    // Getters
+    LevelType get_level_type() const;
+    Price get_min_price() const;
+    Price get_max_price() const;
+    bool is_valid_price(Price price) const;
+    bool empty() const;
+    std::size_t size() const;
+
+    PriceLevel& at(Price price);
+    PriceLevel* find(Price price);
+    PriceLevel& best();
+    const PriceLevel& best() const;
+    PriceLevel* next_level(const PriceLevel& price_level);
+
+    // Modifiers
+    void mark_occupied(const PriceLevel& price_level);
+    void mark_empty(const PriceLevel& price_level);
+
+    // Snapshots
+    void save_snapshot(SnapshotWriter& writer) const;
+    void load_snapshot(SnapshotReader& reader);
+
+  private:
+    static constexpr std::size_t block_size = 64;
+
+    LevelType m_level_type;
+    Price m_base_price;
+    Price m_tick_size;
+    std::size_t m_num_levels;
+    OrderBook& m_order_book;
+
+    // One PriceLevel per tick, in ascending price order, in blocks of
+    // block_size levels. An empty block has not been allocated yet; an
+    // allocated one never grows, so its levels never move.
+    std::vector<std::vector<PriceLevel>> m_blocks;
+
+    // Bit i of m_occupancy is set iff level i has open orders.
+    // Bit w of m_summary is set iff m_occupancy[w] != 0.
+    std::vector<uint64_t> m_occupancy;
+    std::vector<uint64_t> m_summary;
+
+    // Index of the best (highest bid / lowest ask) occupied level or npos.
+    std::size_t m_best_index;
+    std::size_t m_num_occupied;
+
+    PriceLevel& level(std::size_t index);
+    const PriceLevel& level(std::size_t index) const;
+    PriceLevel& allocate_level(std::size_t index);
+    std::size_t to_index(Price price) const;
+    std::size_t to_index(const PriceLevel& price_level) const;
+    bool is_better(std::size_t lhs, std::size_t rhs) const;
+    std::size_t find_next(std::size_t from) const;
+    std::size_t find_prev(std::size_t from) const;
+    std::size_t find_next_worse(std::size_t index) const;
+};
+}
+
+#endif
@@ -13,7 +13,6 @@
 
 namespace dev {
 
-using FreeList = std::deque<SeqNum>;
 class MarketDataManager;
 class OrderBook;
 
@@ -23,8 +22,21 @@ enum class LevelType
     ASK
 };
 
+/**
+ * @brief Aggregate view of one price level, as returned by depth queries.
+ */
+struct DepthLevel
+{
+    Price price;
+    Quantity quantity;
+    std::size_t order_count;
+};
+
 /**
  * @brief A PriceLevel is a queue of open orders at a given price.
+ *
+ * The level keeps the total open quantity and the number of orders in its
+ * queue up to date on every change, so both are read in O(1).
  */
 class PriceLevel
 {
@@ -43,13 +55,15 @@ class PriceLevel
     // Getters
     LevelType get_level_type() const;
     Price get_price() const;
-    SeqNum get_first_seq_num();
-    SeqNum get_last_seq_num();
+    SeqNum get_first_seq_num() const;
+    SeqNum get_last_seq_num() const;
     Order& front();
     Order& back();
+    Quantity get_total_quantity() const;
+    std::size_t get_order_count() const;
 
     // Validation
-    bool can_fill(Order order);
+    bool can_fill(const Order& order) const;
     bool is_empty();
 
     // Modifiers
@@ -58,7 +72,14 @@ class PriceLevel
     void pop_front();
     void push_back(Order order);
     void pop_back();
-    void fill_order(Order order);
+    void erase(SeqNum seq_num);
+    void unlink(SeqNum seq_num);
+    void fill_order(Quantity fill_quantity);
+    void modify_order(SeqNum seq_num, Quantity new_quantity);
+    void restore(SeqNum first_seq_num,
+                 SeqNum last_seq_num,
+                 Quantity total_quantity,
+                 std::size_t order_count);
 
   private:
     // Level type
@@ -72,7 +93,11 @@ class PriceLevel
     SeqNum m_first_seq_num;
     SeqNum m_last_seq_num;
 
-    // Reference to the order_pool and free_list
+    // Open quantity and number of orders queued at this level
+    Quantity m_total_quantity;
+    std::size_t m_order_count;
+
+    // Reference to the order book owning the order_pool
     OrderBook& m_order_book;
 };
 
@@ -0,0 +1,117 @@
+#ifndef SHARDED_ENGINE_H
+#define SHARDED_ENGINE_H
+
+#include "command.h"
+#include "market_data_manager.h"
+#include "order_book_config.h"
+#include "spsc_queue.h"
+#include "symbol_directory.h"
+#include "trade_listener.h"
+#include "user_registry.h"
+#include "usings.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace dev {
+
+/**
+ * @brief A command tagged with the id the engine returned on submission.
+ */
+struct ShardCommand
+{
+    uint64_t request_id;
+    Command command;
+};
+
+/**
+ * @brief The outcome of the command submitted as @a request_id.
+ */
+struct EngineResult
+{
+    uint64_t request_id;
+    CommandResult result;
+};
+
+/**
+ * @brief A @a ShardedEngine partitions symbols across N matching threads.
+ *
+ * Each shard owns a @a MarketDataManager and with it the order books of its
+ * symbols, which no other thread touches. The ingress thread calling @a submit
+ * maps the symbol to a shard and copies the command into that shard's SPSC
+ * command ring; the shard applies commands in arrival order and copies the
+ * results into its own SPSC result ring, drained by @a poll_results. Symbols
+ * are assigned to shards round-robin as they are first seen, so the match
+ * path takes no lock and shares no cache line with the other shards.
+ *
+ * The shards share one @a UserRegistry. Commands carry user ids, so the shard
+ * threads only resolve them; names are interned by the ingress thread, or
+ * while the engine is stopped.
+ *
+ * @a submit and @a poll_results must each be called from a single thread
+ * (possibly the same one). Trade listeners are invoked on the shard threads.
+ */
+class ShardedEngine
+{
+  public:
+    static constexpr std::size_t queue_capacity = 1u << 12;
+
+    // Constructors
+    explicit ShardedEngine(std::size_t num_shards,
+                           const OrderBookConfig& config = OrderBookConfig{},
+                           std::size_t max_symbols = SymbolDirectory::default_capacity);
+    ShardedEngine(const ShardedEngine&) = delete;
+    ShardedEngine& operator=(const ShardedEngine&) = delete;
+    ~ShardedEngine();
+
+    // Getters
+    std::size_t get_num_shards() const;
+    std::optional<std::size_t> get_shard_index(std::string_view symbol_name) const;
+    MarketDataManager& get_shard(std::size_t shard_index);
+    UserRegistry& get_user_registry();
+    bool is_running() const;
+
+    // Modifiers
+    void set_trade_listener(TradeListener* trade_listener);
+    void start(bool pin_threads = true);
+    void stop();
+    std::optional<uint64_t> submit(const Command& command);
+    std::size_t poll_results(std::span<EngineResult> results);
+
+  private:
+    struct Shard
+    {
+        Shard(const OrderBookConfig& config,
+              std::size_t max_symbols,
+              UserRegistry& user_registry);
+
+        MarketDataManager market_data_manager;
+        SpscQueue<ShardCommand, queue_capacity> commands;
+        SpscQueue<EngineResult, queue_capacity> results;
+        std::jthread worker;
+    };
+
+    // Shared by the shards, which it outlives
+    UserRegistry m_user_registry;
+
+    std::vector<std::unique_ptr<Shard>> m_shards;
+
+    // Owned by the ingress thread: assigns symbols to shards
+    SymbolDirectory m_symbol_directory;
+    uint64_t m_next_request_id;
+
+    // Shard polled first by the next poll_results, for fairness
+    std::size_t m_next_poll_shard;
+
+    std::size_t route(const Command& command);
+    static void run(Shard& shard, std::stop_token stop_token);
+    static void pin_to_cpu(std::jthread& worker, std::size_t cpu);
+};
+}
+#endif
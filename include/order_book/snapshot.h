@@ -0,0 +1,99 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace dev {
+
+/**
+ * @brief A @a SnapshotWriter streams the binary image of the books to a file.
+ *
+ * Values are written in host layout through a large buffer; arrays of nodes
+ * bypass it and go to the file in one system call. The image is written to a
+ * temporary file and renamed over @a path by @a commit, so a crash while
+ * writing leaves the previous snapshot intact.
+ */
+class SnapshotWriter
+{
+  public:
+    static constexpr std::size_t buffer_size = std::size_t{ 1 } << 20;
+
+    explicit SnapshotWriter(const std::string& path);
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+    ~SnapshotWriter();
+
+    void write_bytes(std::span<const std::byte> bytes);
+    void commit();
+
+    template<typename T>
+    void write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write_bytes(std::as_bytes(std::span<const T>(&value, 1)));
+    }
+
+    template<typename T>
+    void write_array(std::span<const T> values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write_bytes(std::as_bytes(values));
+    }
+
+  private:
+    std::string m_path;
+    std::string m_temporary_path;
+    int m_fd;
+    std::vector<std::byte> m_buffer;
+
+    void flush_buffer();
+    void write_fully(std::span<const std::byte> bytes);
+};
+
+/**
+ * @brief A @a SnapshotReader maps a snapshot file read-only and hands out its
+ * contents in order, so that arrays are restored with one copy each straight
+ * from the page cache. Reading past the end throws.
+ */
+class SnapshotReader
+{
+  public:
+    explicit SnapshotReader(const std::string& path);
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+    ~SnapshotReader();
+
+    std::span<const std::byte> read_bytes(std::size_t size);
+    bool at_end() const;
+
+    template<typename T>
+    T read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        std::memcpy(&value, read_bytes(sizeof(T)).data(), sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    void read_array(std::span<T> values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        std::span<const std::byte> bytes = read_bytes(values.size_bytes());
+        std::memcpy(values.data(), bytes.data(), bytes.size());
+    }
+
+  private:
+    int m_fd;
+    const std::byte* m_mapping;
+    std::size_t m_size;
+    std::size_t m_position;
+};
+}
+#endif
@@ -0,0 +1,95 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include "usings.h"
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace dev {
+
+/**
+ * @brief A bounded, lock-free, single-producer single-consumer ring buffer.
+ *
+ * All slots are allocated up-front; @a try_push and @a try_pop never allocate
+ * and never block. Each side keeps a cached copy of the other side's index so
+ * that the shared cache lines are only touched when the cached view says the
+ * queue is full (producer) or empty (consumer).
+ *
+ * @tparam T Element type, copied into and out of pre-constructed slots.
+ * @tparam Capacity Number of slots, must be a power of two.
+ */
+template<typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscQueue capacity must be a power of two");
+
+  public:
+    SpscQueue()
+      : m_slots(Capacity)
+    {
+    }
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * @brief Producer side. Returns false if the queue is full.
+     */
+    bool try_push(const T& value)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cached_head == Capacity) {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+            if (tail - m_cached_head == Capacity)
+                return false;
+        }
+
+        m_slots[tail & (Capacity - 1)] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Consumer side. Returns false if the queue is empty.
+     */
+    bool try_pop(T& value)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cached_tail) {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cached_tail)
+                return false;
+        }
+
+        value = m_slots[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Approximate number of queued elements.
+     */
+    std::size_t size() const
+    {
+        return m_tail.load(std::memory_order_acquire) -
+               m_head.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+  private:
+    // Consumer-owned
+    alignas(cache_line_size) std::atomic<std::size_t> m_head{ 0u };
+    std::size_t m_cached_tail{ 0u };
+
+    // Producer-owned
+    alignas(cache_line_size) std::atomic<std::size_t> m_tail{ 0u };
+    std::size_t m_cached_head{ 0u };
+
+    alignas(cache_line_size) std::vector<T> m_slots;
+};
+}
+#endif
@@ -0,0 +1,72 @@
+#ifndef SYMBOL_DIRECTORY_H
+#define SYMBOL_DIRECTORY_H
+
+#include "usings.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+namespace dev {
+
+/**
+ * @brief A @a SymbolDirectory assigns each traded symbol a dense @a SymbolId
+ * when it is onboarded, used to index the order books.
+ *
+ * Symbols are 1 to 4 characters long, the width of the symbol carried by
+ * @a OrderId. A symbol is resolved by loading its zero-padded characters as a
+ * single `uint32_t` key and probing a flat, open-addressed table kept at most
+ * half full, so that a lookup is a multiply, a shift and usually one compare.
+ * Distinct symbols have distinct keys: there are no collisions to resolve
+ * beyond the probe sequence.
+ *
+ * Like @a UserRegistry, symbols are stored in a fixed-capacity array that never
+ * reallocates, so an id handed out may be resolved from another thread.
+ */
+class SymbolDirectory
+{
+  public:
+    static constexpr std::size_t default_capacity = 1u << 10;
+
+    // Constructors
+    explicit SymbolDirectory(std::size_t capacity = default_capacity);
+    SymbolDirectory(const SymbolDirectory&) = delete;
+    SymbolDirectory& operator=(const SymbolDirectory&) = delete;
+
+    // Getters
+    std::optional<SymbolId> find(std::string_view symbol_name) const;
+    std::optional<SymbolId> find(uint32_t key) const;
+    std::string_view get_symbol_name(SymbolId symbol_id) const;
+    std::size_t size() const;
+    std::size_t capacity() const;
+
+    // Modifiers
+    SymbolId intern(std::string_view symbol_name);
+
+    static uint32_t to_key(std::string_view symbol_name);
+
+  private:
+    // Key 0 marks an empty slot, no symbol maps to it
+    struct Slot
+    {
+        uint32_t key;
+        SymbolId symbol_id;
+    };
+
+    std::size_t m_capacity;
+    std::unique_ptr<std::array<char, 4>[]> m_symbol_names;
+
+    // Open-addressed with linear probing, 2^m_table_bits slots
+    std::size_t m_table_bits;
+    std::unique_ptr<Slot[]> m_table;
+
+    // Number of published symbols
+    std::atomic<std::size_t> m_size;
+
+    std::size_t to_slot(uint32_t key) const;
+};
+}
+#endif
@@ -0,0 +1,106 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "order_id.h"
+#include "usings.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace dev {
+class SnapshotReader;
+class SnapshotWriter;
+
+/**
+ * @brief An order scheduled to expire at @a expire_time.
+ */
+struct TimerEntry
+{
+    OrderId order_id;
+    Timestamp expire_time;
+};
+
+/**
+ * @brief A @a TimerWheel is a hierarchical timing wheel indexing orders by the
+ * time at which they expire.
+ *
+ * Level `l` has 64 slots of `64^l` ticks each. An entry is stored at the lowest
+ * level whose slot separates its expiry from the current tick, and moves down
+ * one or more levels when the wheel reaches the start of its slot, so that
+ * scheduling is O(1) and expiring is O(expired). Expiries beyond the range of
+ * the top level wait in an overflow list. A 64-bit occupancy mask per level lets
+ * the wheel jump over empty slots instead of stepping through every tick, and
+ * the overflow list jumps straight to the period of its earliest expiry.
+ *
+ * @a collect_expired does a bounded amount of work per call: moving an entry
+ * down a level or out of the overflow list costs as much as handing one out,
+ * and a cascade too large for the caller's budget resumes on the next call.
+ *
+ * Entries are not removed when their order is filled or cancelled: the wheel
+ * hands the stale @a OrderId back on expiry and the caller checks it against
+ * the order pool, which rejects handles to released slots.
+ */
+class TimerWheel
+{
+  public:
+    static constexpr std::size_t num_levels = 5;
+    static constexpr std::size_t slot_bits = 6;
+    static constexpr std::size_t num_slots = std::size_t{ 1 } << slot_bits;
+
+    // Constructors
+    explicit TimerWheel(Timestamp start_time = 0);
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Getters
+    Timestamp get_current_time() const;
+    std::size_t size() const;
+    bool empty() const;
+    bool has_expired(Timestamp now) const;
+    uint64_t get_work_done() const;
+
+    // Modifiers
+    void schedule(OrderId order_id, Timestamp expire_time);
+    std::size_t collect_expired(Timestamp now, std::span<OrderId> expired_ids);
+
+    // Snapshots
+    void save_snapshot(SnapshotWriter& writer) const;
+    void load_snapshot(SnapshotReader& reader);
+
+  private:
+    using Slot = std::vector<TimerEntry>;
+
+    std::array<std::array<Slot, num_slots>, num_levels> m_levels;
+    // Bit s of m_occupancy[l] is set iff m_levels[l][s] is not empty
+    std::array<uint64_t, num_levels> m_occupancy;
+    Slot m_overflow;
+    // Earliest expiry in m_overflow
+    Timestamp m_overflow_min;
+
+    // Next tick to expire; all entries due before it have been handed out
+    Timestamp m_current_tick;
+    // Read position in the level 0 slot of m_current_tick, so that a slot
+    // larger than the caller's budget is drained over several calls
+    std::size_t m_drain_position;
+    bool m_is_draining;
+    // Level whose slot at m_current_tick is being moved down, num_levels for
+    // the overflow list, 0 if no cascade is in progress; read position in it
+    std::size_t m_cascade_level;
+    std::size_t m_cascade_position;
+    // Entries the overflow pass keeps are compacted to the front of the list
+    std::size_t m_overflow_kept;
+    Timestamp m_overflow_kept_min;
+    std::size_t m_size;
+    uint64_t m_work_done;
+
+    std::size_t level_of(Timestamp expire_tick) const;
+    void insert(const TimerEntry& entry);
+    void start_cascade(std::size_t below_level);
+    std::size_t continue_cascade(std::size_t max_work);
+    Timestamp find_next_tick() const;
+};
+}
+
+#endif
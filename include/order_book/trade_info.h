@@ -3,6 +3,7 @@
 
 #include "order_id.h"
 #include "usings.h"
+#include <type_traits>
 
 enum class FillType
 {
@@ -19,5 +20,7 @@ struct TradeInfo
     Price price;
     Quantity quantity;
 };
+
+static_assert(std::is_trivially_copyable_v<TradeInfo>);
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,20 @@
+#ifndef TRADE_LISTENER_H
+#define TRADE_LISTENER_H
+
+#include "trade.h"
+
+namespace dev {
+
+/**
+ * @brief A @a TradeListener is notified synchronously by the matching engine
+ * for every fill. The @a Trade is only valid for the duration of the call,
+ * implementations must copy what they need and must not block.
+ */
+class TradeListener
+{
+  public:
+    virtual ~TradeListener() = default;
+    virtual void on_trade(const Trade& trade) = 0;
+};
+}
+#endif
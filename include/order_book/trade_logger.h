@@ -0,0 +1,57 @@
+#ifndef TRADE_LOGGER_H
+#define TRADE_LOGGER_H
+
+#include "spsc_queue.h"
+#include "trade.h"
+#include "trade_listener.h"
+#include "user_registry.h"
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <thread>
+
+namespace dev {
+
+/**
+ * @brief A @a TradeLogger is an optional @a TradeListener that moves trade
+ * formatting and I/O off the matching thread.
+ *
+ * Trades carry interned user handles; when a @a UserRegistry is supplied they
+ * are resolved to names here, on the logger thread.
+ *
+ * Trades are copied into a pre-allocated SPSC ring from the matching thread
+ * and formatted on a background thread. If the ring is full the trade is
+ * dropped (and counted) rather than stalling the matching thread.
+ */
+class TradeLogger : public TradeListener
+{
+  public:
+    static constexpr std::size_t queue_capacity = 4096;
+
+    explicit TradeLogger(std::ostream& os, const UserRegistry* user_registry = nullptr);
+    TradeLogger(const TradeLogger&) = delete;
+    TradeLogger& operator=(const TradeLogger&) = delete;
+    ~TradeLogger() override;
+
+    void on_trade(const Trade& trade) override;
+
+    uint64_t get_dropped_count() const;
+
+  private:
+    std::ostream& m_os;
+
+    // Used to resolve UserId handles to names at publication, may be null
+    const UserRegistry* m_user_registry;
+    SpscQueue<Trade, queue_capacity> m_queue;
+    std::atomic<uint64_t> m_dropped_count;
+
+    // Declared last so that it is started after and joined before the
+    // members it uses are destroyed.
+    std::jthread m_worker;
+
+    void run(std::stop_token stop_token);
+    void drain();
+    std::string_view get_user_name(UserId user_id) const;
+};
+}
+#endif
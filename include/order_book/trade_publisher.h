@@ -0,0 +1,57 @@
+#ifndef TRADE_PUBLISHER_H
+#define TRADE_PUBLISHER_H
+
+#include "mpmc_queue.h"
+#include "trade.h"
+#include "trade_listener.h"
+#include <atomic>
+#include <cstdint>
+#include <stop_token>
+#include <thread>
+
+namespace dev {
+
+/**
+ * @brief A @a TradePublisher is a @a TradeListener that hands trades from any
+ * number of matching threads to a single publisher thread.
+ *
+ * @a on_trade copies the trade into a pre-allocated MPMC ring and returns: no
+ * I/O, formatting or lock on the matching thread. The publisher thread drains
+ * the ring in batches and forwards every trade, in per-producer order, to the
+ * downstream listener (e.g. a @a TradeLogger or a network sender), which is
+ * therefore only ever called from the publisher thread. If the ring is full
+ * the trade is dropped and counted rather than stalling the matching thread.
+ */
+class TradePublisher : public TradeListener
+{
+  public:
+    static constexpr std::size_t queue_capacity = 1u << 14;
+    static constexpr std::size_t batch_capacity = 256;
+
+    explicit TradePublisher(TradeListener& downstream);
+    TradePublisher(const TradePublisher&) = delete;
+    TradePublisher& operator=(const TradePublisher&) = delete;
+    ~TradePublisher() override;
+
+    void on_trade(const Trade& trade) override;
+
+    // Monitoring, safe to call from any thread
+    std::size_t get_queue_depth() const;
+    uint64_t get_dropped_count() const;
+    uint64_t get_published_count() const;
+
+  private:
+    TradeListener& m_downstream;
+    MpmcQueue<Trade, queue_capacity> m_queue;
+    std::atomic<uint64_t> m_dropped_count;
+    std::atomic<uint64_t> m_published_count;
+
+    // Declared last so that it is started after and joined before the
+    // members it uses are destroyed.
+    std::jthread m_worker;
+
+    void run(std::stop_token stop_token);
+    std::size_t drain();
+};
+}
+#endif
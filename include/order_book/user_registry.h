@@ -0,0 +1,53 @@
+#ifndef USER_REGISTRY_H
+#define USER_REGISTRY_H
+
+#include "usings.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace dev {
+
+/**
+ * @brief A @a UserRegistry interns user names into dense 32-bit @a UserId
+ * handles, so that orders and trades carry a handle instead of a string.
+ *
+ * Names live in a fixed-capacity array that never reallocates: interning
+ * happens on the matching thread, while publishers may resolve any id that
+ * has already been handed out from another thread.
+ */
+class UserRegistry
+{
+  public:
+    static constexpr std::size_t default_capacity = 1u << 16;
+
+    // Constructors
+    explicit UserRegistry(std::size_t capacity = default_capacity);
+    UserRegistry(const UserRegistry&) = delete;
+    UserRegistry& operator=(const UserRegistry&) = delete;
+
+    // Getters
+    std::optional<UserId> find(std::string_view user_name) const;
+    std::string_view get_user_name(UserId user_id) const;
+    std::size_t size() const;
+    std::size_t capacity() const;
+
+    // Modifiers
+    UserId intern(std::string_view user_name);
+
+  private:
+    std::size_t m_capacity;
+    std::unique_ptr<std::string[]> m_user_names;
+
+    // Keys view into m_user_names, which never moves
+    std::unordered_map<std::string_view, UserId> m_user_ids;
+
+    // Number of published names
+    std::atomic<std::size_t> m_size;
+};
+}
+#endif
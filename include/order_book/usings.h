@@ -1,6 +1,7 @@
 #ifndef USINGS_H
 #define USINGS_H
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -9,6 +10,13 @@ using Price = uint64_t;
 using Quantity = uint64_t;
 using SeqNum = uint32_t;
 using Side = char;
-using UserId = std::string;
+// Interned user handle, see UserRegistry
+using UserId = uint32_t;
+// Dense order book index, see SymbolDirectory
+using SymbolId = uint32_t;
+// Ticks of the book clock, e.g. milliseconds since the epoch
+using Timestamp = uint64_t;
+
+inline constexpr std::size_t cache_line_size = 64;
 } // namespace dev
 #endif
\ No newline at end of file
@@ -0,0 +1,267 @@
+#include "journal.h"
+#include "order_entry_decoder.h"
+#include "order_entry_protocol.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace dev {
+namespace {
+[[noreturn]] void
+throw_system_error(int error, const std::string& what)
+{
+    throw std::system_error(error, std::generic_category(), what);
+}
+}
+
+Journal::Journal(const std::string& path, const JournalConfig& config)
+  : m_fd{ -1 }
+  , m_mapping{ nullptr }
+  , m_mapping_size{ 0u }
+  , m_header{ nullptr }
+  , m_data{ nullptr }
+  , m_capacity{ 0u }
+  , m_size{ 0u }
+  , m_sequence_number{ 0u }
+  , m_flush_mutex{}
+  , m_flushed_size{ 0u }
+  , m_flushed_sequence_number{ 0u }
+  , m_flush_error{}
+  , m_has_flush_error{ false }
+  , m_flusher{}
+{
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (m_fd < 0)
+        throw_system_error(errno, std::format("Cannot open journal {}", path));
+
+    struct stat file_stat{};
+    if (::fstat(m_fd, &file_stat) != 0) {
+        int error = errno;
+        ::close(m_fd);
+        throw_system_error(error, std::format("Cannot stat journal {}", path));
+    }
+
+    bool is_new = file_stat.st_size == 0;
+    m_mapping_size = is_new ? sizeof(FileHeader) + config.capacity
+                            : static_cast<std::size_t>(file_stat.st_size);
+    if (is_new) {
+        // Allocate every block now rather than on the append path
+        int error = ::posix_fallocate(m_fd, 0, static_cast<off_t>(m_mapping_size));
+        if (error != 0) {
+            ::close(m_fd);
+            throw_system_error(error, std::format("Cannot allocate journal {}", path));
+        }
+    }
+
+    void* mapping =
+      ::mmap(nullptr, m_mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (mapping == MAP_FAILED) {
+        int error = errno;
+        ::close(m_fd);
+        throw_system_error(error, std::format("Cannot map journal {}", path));
+    }
+
+    m_mapping = static_cast<std::byte*>(mapping);
+    m_header = reinterpret_cast<FileHeader*>(m_mapping);
+    m_data = m_mapping + sizeof(FileHeader);
+    if (is_new) {
+        *m_header = FileHeader{ .magic = magic,
+                                .version = version,
+                                .reserved = 0,
+                                .capacity = config.capacity,
+                                .size = 0 };
+    } else if (m_header->magic != magic || m_header->version != version ||
+               sizeof(FileHeader) + m_header->capacity != m_mapping_size ||
+               m_header->size > m_header->capacity) {
+        ::munmap(m_mapping, m_mapping_size);
+        ::close(m_fd);
+        throw std::logic_error(std::format("{} is not a journal", path));
+    }
+
+    m_capacity = m_header->capacity;
+    m_size = m_header->size;
+    m_flushed_size = m_size;
+
+    // Count the messages already written
+    uint64_t sequence_number{ 0 };
+    for (std::size_t offset{ 0 }; offset < m_size; offset = next_message(offset))
+        ++sequence_number;
+    m_sequence_number.store(sequence_number);
+    m_flushed_sequence_number.store(sequence_number);
+
+    if (config.flush_interval.has_value()) {
+        std::chrono::microseconds interval = *config.flush_interval;
+        m_flusher = std::jthread{ [this, interval](std::stop_token stop_token) {
+            run_flusher(stop_token, interval);
+        } };
+    }
+}
+
+Journal::~Journal()
+{
+    if (m_flusher.joinable()) {
+        m_flusher.request_stop();
+        m_flusher.join();
+    }
+
+    // A destructor cannot report the error; the pages still reach the disk
+    // when the kernel writes them back
+    try {
+        flush();
+    } catch (const std::system_error&) {
+    }
+    ::munmap(m_mapping, m_mapping_size);
+    ::close(m_fd);
+}
+
+// Getters
+/**
+ * @brief Sequence number of the last message appended, 0 if there is none.
+ */
+uint64_t
+Journal::get_sequence_number() const
+{
+    return m_sequence_number.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Sequence number of the last message known to be on disk.
+ */
+uint64_t
+Journal::get_flushed_sequence_number() const
+{
+    return m_flushed_sequence_number.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Bytes of messages appended so far.
+ */
+std::size_t
+Journal::get_size() const
+{
+    return m_size;
+}
+
+std::size_t
+Journal::get_capacity() const
+{
+    return m_capacity;
+}
+
+// Modifiers
+/**
+ * @brief Append one order-entry message and return its sequence number.
+ * Throws std::length_error when the journal is full, and the error of the
+ * flush thread once a flush has failed.
+ */
+uint64_t
+Journal::append(std::span<const std::byte> message)
+{
+    if (m_has_flush_error.load(std::memory_order_acquire))
+        std::rethrow_exception(m_flush_error);
+    if (message.size() % message_alignment != 0)
+        throw std::logic_error(std::format(
+          "Journal messages must be a multiple of {} bytes", message_alignment));
+    if (message.size() > m_capacity - m_size)
+        throw std::length_error("The journal is full");
+
+    std::memcpy(m_data + m_size, message.data(), message.size());
+    m_size += message.size();
+    std::atomic_ref<uint64_t>{ m_header->size }.store(m_size, std::memory_order_release);
+    return m_sequence_number.fetch_add(1u, std::memory_order_release) + 1;
+}
+
+/**
+ * @brief Write the messages appended so far to disk and wait until they are
+ * there. Called by the flush thread; may also be called by the appending
+ * thread, e.g. before acknowledging a command.
+ */
+void
+Journal::flush()
+{
+    std::lock_guard<std::mutex> lock{ m_flush_mutex };
+
+    // The size is published before the sequence number, so it covers at
+    // least sequence_number messages
+    uint64_t sequence_number = m_sequence_number.load(std::memory_order_acquire);
+    std::size_t size =
+      std::atomic_ref<uint64_t>{ m_header->size }.load(std::memory_order_acquire);
+    if (size == m_flushed_size)
+        return;
+
+    // msync takes page-aligned ranges; the header page is included whenever
+    // the range starts on the first page
+    std::size_t page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    std::size_t begin = (sizeof(FileHeader) + m_flushed_size) / page_size * page_size;
+    std::size_t end = sizeof(FileHeader) + size;
+    if (::msync(m_mapping + begin, end - begin, MS_SYNC) != 0 ||
+        (begin != 0 && ::msync(m_mapping, page_size, MS_SYNC) != 0))
+        throw_system_error(errno, "Cannot flush the journal");
+
+    m_flushed_size = size;
+    m_flushed_sequence_number.store(sequence_number, std::memory_order_release);
+}
+
+/**
+ * @brief Apply the messages after @a after_sequence_number to the books of
+ * @a decoder, in place from the mapping. The decoder must not be journaling
+ * into this journal. Returns the number of messages replayed.
+ */
+uint64_t
+Journal::replay(OrderEntryDecoder& decoder, uint64_t after_sequence_number)
+{
+    std::size_t offset{ 0 };
+    for (uint64_t i{ 0 }; i < after_sequence_number && offset < m_size; ++i)
+        offset = next_message(offset);
+
+    ::madvise(m_mapping, m_mapping_size, MADV_SEQUENTIAL);
+    uint64_t message_count = decoder.get_message_count();
+    std::size_t num_decoded =
+      decoder.decode(std::span<const std::byte>(m_data + offset, m_size - offset));
+    if (offset + num_decoded != m_size)
+        throw std::logic_error("The journal ends with a truncated message");
+
+    return decoder.get_message_count() - message_count;
+}
+
+// Helpers
+/**
+ * @brief Offset of the message after the one at @a offset.
+ */
+std::size_t
+Journal::next_message(std::size_t offset) const
+{
+    if (m_size - offset < sizeof(MessageHeader))
+        throw std::logic_error("The journal ends with a truncated message");
+
+    const auto& header = *reinterpret_cast<const MessageHeader*>(m_data + offset);
+    if (header.length < sizeof(MessageHeader) || header.length > m_size - offset)
+        throw std::logic_error(std::format(
+          "Journal message at offset {} has length {}", offset, header.length));
+    return offset + header.length;
+}
+
+/**
+ * @brief Flush thread: flush every @a interval until stopped or a flush fails.
+ * The error is left for @a append to rethrow, rather than escaping the thread.
+ */
+void
+Journal::run_flusher(std::stop_token stop_token, std::chrono::microseconds interval)
+{
+    try {
+        while (!stop_token.stop_requested()) {
+            std::this_thread::sleep_for(interval);
+            flush();
+        }
+    } catch (const std::system_error&) {
+        m_flush_error = std::current_exception();
+        m_has_flush_error.store(true, std::memory_order_release);
+    }
+}
+}
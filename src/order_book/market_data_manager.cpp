@@ -1,38 +1,89 @@
 #include "market_data_manager.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <array>
 
 namespace dev {
-// Constructors
-MarketDataManager::MarketDataManager()
-  : m_order_books{}
+namespace {
+constexpr uint64_t snapshot_magic = 0x50414e534b4f4f42; // "BOOKSNAP"
+constexpr uint32_t snapshot_version = 1;
+
+/**
+ * @brief The first bytes of a snapshot file.
+ */
+struct SnapshotHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t num_symbols;
+    uint64_t sequence_number;
+    uint64_t num_users;
+};
+
+/**
+ * @brief Split @a items into maximal runs of consecutive entries for the same
+ * symbol and call @a f(symbol_name, first, last) for each run. Gateways batch
+ * per symbol, so the book lookup is paid once per run rather than per command.
+ */
+template<typename T, typename F>
+void
+for_each_symbol_run(std::span<const T> items, F&& f)
 {
+    std::size_t first{ 0 };
+    while (first < items.size()) {
+        std::string_view symbol_name = items[first].get_symbol_name();
+        std::size_t last = first + 1;
+        while (last < items.size() && items[last].get_symbol_name() == symbol_name)
+            ++last;
+
+        f(symbol_name, first, last);
+        first = last;
+    }
+}
 }
 
-// Getters
-std::unordered_map<size_t, OrderBook>&
-MarketDataManager::get_order_books()
+// Constructors
+MarketDataManager::MarketDataManager(const OrderBookConfig& config,
+                                     std::size_t max_symbols,
+                                     UserRegistry* user_registry)
+  : m_config{ config }
+  , m_trade_listener{ nullptr }
+  , m_owned_user_registry{ user_registry == nullptr ? std::make_unique<UserRegistry>()
+                                                    : nullptr }
+  , m_user_registry{ user_registry == nullptr ? m_owned_user_registry.get()
+                                              : user_registry }
+  , m_symbol_directory{ max_symbols }
+  , m_order_books{ std::make_unique<std::optional<OrderBook>[]>(max_symbols) }
 {
-    return m_order_books;
 }
 
-auto
-MarketDataManager::get_order_book_iter(std::string_view symbol_name)
+// Getters
+OrderBook&
+MarketDataManager::get_order_book(std::string_view symbol_name)
 {
-    if (m_order_books.size() == 0) {
-        return m_order_books.end();
-    }
-    auto loc = m_order_books.find(std::hash<std::string_view>{}(symbol_name));
+    OrderBook* order_book = find_order_book(symbol_name, false);
+    if (order_book == nullptr)
+        throw std::logic_error("Order book not found for the user-supplied symbol");
 
-    return loc;
+    return *order_book;
 }
+
+/**
+ * @brief Get the book of an onboarded symbol by index, without a lookup.
+ */
 OrderBook&
-MarketDataManager::get_order_book(std::string_view symbol_name)
+MarketDataManager::get_order_book(SymbolId symbol_id)
 {
-    auto loc = get_order_book_iter(symbol_name);
+    if (symbol_id >= m_symbol_directory.size())
+        throw std::logic_error(std::format("SymbolId {} is not registered!", symbol_id));
 
-    if (loc == m_order_books.end())
-        throw std::logic_error("Order book not found for the user-supplied symbol");
+    return *m_order_books[symbol_id];
+}
 
-    return loc->second;
+SymbolDirectory&
+MarketDataManager::get_symbol_directory()
+{
+    return m_symbol_directory;
 }
 
 /**
@@ -42,12 +93,35 @@ MarketDataManager::get_order_book(std::string_view symbol_name)
 Order&
 MarketDataManager::get_order(OrderId order_id)
 {
-    OrderBook& order_book = get_order_book(order_id.symbol_name);
+    OrderBook& order_book = get_order_book(order_id.get_symbol_name());
     return order_book.get_order(order_id);
 }
 
+UserRegistry&
+MarketDataManager::get_user_registry()
+{
+    return *m_user_registry;
+}
+
 // Modifiers
-void
+/**
+ * @brief Onboard @a symbol_name: assign it a SymbolId and create its order
+ * book. Onboarding a known symbol returns its existing id.
+ */
+SymbolId
+MarketDataManager::add_symbol(std::string_view symbol_name)
+{
+    SymbolId symbol_id = m_symbol_directory.intern(symbol_name);
+    std::optional<OrderBook>& order_book = m_order_books[symbol_id];
+    if (!order_book.has_value()) {
+        // Order books are not movable, construct them in place
+        order_book.emplace(m_config);
+        order_book->set_trade_listener(m_trade_listener);
+    }
+    return symbol_id;
+}
+
+OrderId
 MarketDataManager::add_order(OrderType order_type,
                              UserId user_id,
                              Side side,
@@ -55,40 +129,310 @@ MarketDataManager::add_order(OrderType order_type,
                              Price price,
                              Quantity quantity)
 {
-    auto it = get_order_book_iter(symbol_name);
+    OrderBook& order_book = *find_order_book(symbol_name, true);
+    return order_book.add_order(order_type, user_id, side, symbol_name, price, quantity);
+}
 
-    // Order book validation
-    if (it == m_order_books.end()) {
-        add_order_book(symbol_name);
-        it = get_order_book_iter(symbol_name);
-    }
+/**
+ * @brief Convenience overload interning @a user_name on every call. Gateways
+ * should intern once per session and use the UserId overload.
+ */
+OrderId
+MarketDataManager::add_order(OrderType order_type,
+                             std::string_view user_name,
+                             Side side,
+                             std::string_view symbol_name,
+                             Price price,
+                             Quantity quantity)
+{
+    return add_order(order_type,
+                     m_user_registry->intern(user_name),
+                     side,
+                     symbol_name,
+                     price,
+                     quantity);
+}
 
-    OrderBook& order_book = it->second;
-    return order_book.add_order(order_type, user_id, side, symbol_name, price, quantity);
+/**
+ * @brief Add a STOP or STOP_LIMIT order, see OrderBook::add_stop_order.
+ */
+OrderId
+MarketDataManager::add_stop_order(OrderType order_type,
+                                  UserId user_id,
+                                  Side side,
+                                  std::string_view symbol_name,
+                                  Price stop_price,
+                                  Price price,
+                                  Quantity quantity)
+{
+    OrderBook& order_book = *find_order_book(symbol_name, true);
+    return order_book.add_stop_order(
+      order_type, user_id, side, symbol_name, stop_price, price, quantity);
 }
 
 void
 MarketDataManager::modify_order(OrderId order_id, Price new_price, Quantity new_quantity)
 {
-    OrderBook& order_book = get_order_book(order_id.symbol_name);
+    OrderBook& order_book = get_order_book(order_id.get_symbol_name());
     order_book.modify_order(order_id, new_price, new_quantity);
 }
 
 void
 MarketDataManager::cancel_order(OrderId order_id)
 {
-    OrderBook& order_book = get_order_book(order_id.symbol_name);
+    OrderBook& order_book = get_order_book(order_id.get_symbol_name());
     order_book.cancel_order(order_id);
 }
 
+/**
+ * @brief Cancel every order of @a user_id for @a symbol_name, see
+ * OrderBook::mass_cancel. Returns the number of orders cancelled.
+ */
+std::size_t
+MarketDataManager::mass_cancel(std::string_view symbol_name,
+                               UserId user_id,
+                               std::optional<Side> side)
+{
+    OrderBook* order_book = find_order_book(symbol_name, false);
+    return order_book == nullptr ? 0 : order_book->mass_cancel(user_id, side);
+}
+
+// Batch API
+/**
+ * @brief Add a batch of orders for any number of symbols. The outcome of
+ * @a order_requests[i] is written to @a results[i].
+ *
+ * Requests are applied in order and grouped into runs of consecutive
+ * requests for the same book, which are handed to @a OrderBook::add_orders
+ * with a single book lookup. Matching remains per order: each aggressor is
+ * matched on arrival, which costs one price comparison when it does not
+ * cross. No heap allocation is performed, except when a new book is created.
+ */
 void
-MarketDataManager::add_order_book(std::string_view symbol_name)
+MarketDataManager::add_orders(std::span<const OrderRequest> order_requests,
+                              std::span<CommandResult> results)
 {
-    m_order_books[std::hash<std::string_view>{}(symbol_name)] = OrderBook{};
+    if (results.size() < order_requests.size())
+        throw std::logic_error("Result buffer is smaller than the batch!");
+
+    for_each_symbol_run(
+      order_requests,
+      [&](std::string_view symbol_name, std::size_t first, std::size_t last) {
+          OrderBook* order_book = try_find_order_book(symbol_name, true);
+          if (order_book == nullptr) {
+              for (std::size_t i{ first }; i < last; ++i)
+                  results[i] =
+                    CommandResult{ .status = CommandStatus::REJECTED, .order_id = {} };
+              return;
+          }
+          order_book->add_orders(order_requests.subspan(first, last - first),
+                                 results.subspan(first, last - first));
+      });
 }
+
+/**
+ * @brief Cancel a batch of orders for any number of symbols, see @a add_orders.
+ * Cancels of unknown orders are rejected.
+ */
 void
-MarketDataManager::delete_order_book(std::string_view symbol_name)
+MarketDataManager::cancel_orders(std::span<const OrderId> order_ids,
+                                 std::span<CommandResult> results)
 {
-    m_order_books.erase(std::hash<std::string_view>{}(symbol_name));
+    if (results.size() < order_ids.size())
+        throw std::logic_error("Result buffer is smaller than the batch!");
+
+    for_each_symbol_run(
+      order_ids, [&](std::string_view symbol_name, std::size_t first, std::size_t last) {
+          OrderBook* order_book = find_order_book(symbol_name, false);
+          if (order_book == nullptr) {
+              for (std::size_t i{ first }; i < last; ++i)
+                  results[i] = CommandResult{ .status = CommandStatus::REJECTED,
+                                              .order_id = order_ids[i] };
+              return;
+          }
+          order_book->cancel_orders(order_ids.subspan(first, last - first),
+                                    results.subspan(first, last - first));
+      });
+}
+
+/**
+ * @brief Apply a batch of mixed add, modify and cancel commands for any number
+ * of symbols, see @a add_orders.
+ */
+void
+MarketDataManager::process_commands(std::span<const Command> commands,
+                                    std::span<CommandResult> results)
+{
+    if (results.size() < commands.size())
+        throw std::logic_error("Result buffer is smaller than the batch!");
+
+    for_each_symbol_run(
+      commands, [&](std::string_view symbol_name, std::size_t first, std::size_t last) {
+          // Only an ADD_ORDER may create a book
+          bool has_add = std::any_of(commands.begin() + first,
+                                     commands.begin() + last,
+                                     [](const Command& command) {
+                                         return command.command_type ==
+                                                CommandType::ADD_ORDER;
+                                     });
+
+          OrderBook* order_book = try_find_order_book(symbol_name, has_add);
+          if (order_book == nullptr) {
+              for (std::size_t i{ first }; i < last; ++i)
+                  results[i] = CommandResult{ .status = CommandStatus::REJECTED,
+                                              .order_id = commands[i].order_id };
+              return;
+          }
+          order_book->process_commands(commands.subspan(first, last - first),
+                                       results.subspan(first, last - first));
+      });
+}
+
+/**
+ * @brief Register the listener notified of every fill on every order book,
+ * including books created later. Pass nullptr to detach it.
+ */
+void
+MarketDataManager::set_trade_listener(TradeListener* trade_listener)
+{
+    m_trade_listener = trade_listener;
+    for (SymbolId symbol_id{ 0 }; symbol_id < m_symbol_directory.size(); ++symbol_id)
+        m_order_books[symbol_id]->set_trade_listener(trade_listener);
+}
+
+/**
+ * @brief Set the expiry of GOOD_FOR_DAY orders rested from now on, on every
+ * order book including books created later.
+ */
+void
+MarketDataManager::set_session_close_time(Timestamp session_close_time)
+{
+    m_config.session_close_time = session_close_time;
+    for (SymbolId symbol_id{ 0 }; symbol_id < m_symbol_directory.size(); ++symbol_id)
+        m_order_books[symbol_id]->set_session_close_time(session_close_time);
+}
+
+/**
+ * @brief Cancel the orders due to expire at or before @a now across all order
+ * books, doing at most @a max_orders units of expiry work in total, see
+ * OrderBook::expire_orders. A book is left for the next one only once it has
+ * nothing due. Returns the number of orders cancelled.
+ */
+std::size_t
+MarketDataManager::expire_orders(Timestamp now, std::size_t max_orders)
+{
+    std::size_t num_cancelled{ 0 };
+    for (SymbolId symbol_id{ 0 }; symbol_id < m_symbol_directory.size(); ++symbol_id) {
+        if (max_orders == 0)
+            break;
+
+        OrderBook& order_book = *m_order_books[symbol_id];
+        while (max_orders != 0 && order_book.has_expired_orders(now)) {
+            uint64_t work_done = order_book.get_expiry_work_done();
+            num_cancelled += order_book.expire_orders(now, max_orders);
+            max_orders -= order_book.get_expiry_work_done() - work_done;
+        }
+    }
+    return num_cancelled;
+}
+
+// Snapshots
+/**
+ * @brief Write the state of every book, the symbols and the user names to
+ * @a path. @a sequence_number is the journal sequence number of the last
+ * command applied, from which the journal is replayed after a restore.
+ */
+void
+MarketDataManager::save_snapshot(const std::string& path, uint64_t sequence_number)
+{
+    SnapshotWriter writer{ path };
+    writer.write(
+      SnapshotHeader{ .magic = snapshot_magic,
+                      .version = snapshot_version,
+                      .num_symbols = static_cast<uint32_t>(m_symbol_directory.size()),
+                      .sequence_number = sequence_number,
+                      .num_users = m_user_registry->size() });
+
+    for (UserId user_id{ 0 }; user_id < m_user_registry->size(); ++user_id) {
+        std::string_view user_name = m_user_registry->get_user_name(user_id);
+        writer.write(static_cast<uint32_t>(user_name.size()));
+        writer.write_array(std::span<const char>(user_name));
+    }
+
+    for (SymbolId symbol_id{ 0 }; symbol_id < m_symbol_directory.size(); ++symbol_id) {
+        std::array<char, 4> symbol_name{};
+        std::ranges::copy(m_symbol_directory.get_symbol_name(symbol_id),
+                          symbol_name.begin());
+        writer.write(symbol_name);
+        m_order_books[symbol_id]->save_snapshot(writer);
+    }
+    writer.commit();
+}
+
+/**
+ * @brief Restore the state saved by @a save_snapshot into this new manager,
+ * built with the same configuration. Returns the sequence number the
+ * snapshot was taken at.
+ */
+uint64_t
+MarketDataManager::load_snapshot(const std::string& path)
+{
+    if (m_symbol_directory.size() != 0 || m_user_registry->size() != 0)
+        throw std::logic_error("A snapshot can only be loaded into an empty manager");
+
+    SnapshotReader reader{ path };
+    auto header = reader.read<SnapshotHeader>();
+    if (header.magic != snapshot_magic || header.version != snapshot_version)
+        throw std::logic_error(std::format("{} is not a snapshot", path));
+
+    for (uint64_t i{ 0 }; i < header.num_users; ++i) {
+        auto size = reader.read<uint32_t>();
+        std::span<const std::byte> user_name = reader.read_bytes(size);
+        m_user_registry->intern(
+          std::string_view{ reinterpret_cast<const char*>(user_name.data()), size });
+    }
+
+    for (uint32_t i{ 0 }; i < header.num_symbols; ++i) {
+        auto symbol_name = reader.read<std::array<char, 4>>();
+        SymbolId symbol_id = add_symbol(std::string_view{
+          symbol_name.data(), strnlen(symbol_name.data(), symbol_name.size()) });
+        m_order_books[symbol_id]->load_snapshot(reader);
+    }
+
+    if (!reader.at_end())
+        throw std::logic_error(std::format("{} has trailing data", path));
+    return header.sequence_number;
+}
+
+/**
+ * @brief Get the book for @a symbol_name, onboarding the symbol if @a create
+ * is set. Returns nullptr if the book does not exist and is not created.
+ */
+OrderBook*
+MarketDataManager::find_order_book(std::string_view symbol_name, bool create)
+{
+    std::optional<SymbolId> symbol_id = m_symbol_directory.find(symbol_name);
+    if (!symbol_id.has_value()) {
+        if (!create)
+            return nullptr;
+
+        symbol_id = add_symbol(symbol_name);
+    }
+    return &*m_order_books[*symbol_id];
+}
+
+/**
+ * @brief As @a find_order_book, but returns nullptr if the symbol cannot be
+ * onboarded (malformed symbol or full directory), so that a batch rejects
+ * the affected commands instead of aborting.
+ */
+OrderBook*
+MarketDataManager::try_find_order_book(std::string_view symbol_name, bool create)
+{
+    try {
+        return find_order_book(symbol_name, create);
+    } catch (const std::logic_error&) {
+        return nullptr;
+    }
 }
 }
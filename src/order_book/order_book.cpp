@@ -1,16 +1,25 @@
 #include "order_book.h"
 #include "formatter.h"
+#include "snapshot.h"
+#include <array>
 #include <cstring>
 
 namespace dev {
-OrderBook::OrderBook()
-  : m_bids{}
-  , m_asks{}
-  , m_order_pool{}
-  , m_free_list{}
+OrderBook::OrderBook(const OrderBookConfig& config)
+  : m_order_pool{ config.order_pool_capacity }
+  , m_bids{ LevelType::BID, config, *this }
+  , m_asks{ LevelType::ASK, config, *this }
+  , m_buy_stops{ LevelType::ASK, config, *this, true }
+  , m_sell_stops{ LevelType::BID, config, *this, true }
+  , m_last_trade_price{}
+  , m_trade_listener{ nullptr }
+  , m_market_data_queue{ nullptr }
+  , m_event_seq_num{ 0u }
+  , m_dropped_event_count{ 0u }
+  , m_is_auction_mode{ false }
+  , m_expiry_wheel{ config.start_time }
+  , m_session_close_time{ config.session_close_time }
 {
-    m_order_pool.reserve(10000);
-    m_order_pool.push_back(OrderNode{ .order = std::nullopt, .prev = 0u, .next = 0u });
 }
 
 // Getters
@@ -24,13 +33,13 @@ OrderBook::get_order(OrderId order_id)
     if (!order_exists(order_id))
         throw std::logic_error(std::format("OrderId {} does not exist!", order_id));
 
-    return m_order_pool[order_id.seq_num].order.value();
+    return m_order_pool[order_id.seq_num].order;
 }
 
 /**
  * @brief Get all bids in the order book.
  */
-PriceLevels&
+PriceLadder&
 OrderBook::get_bids()
 {
     return m_bids;
@@ -39,111 +48,94 @@ OrderBook::get_bids()
 /**
  * @brief Get all asks in the order book.
  */
-PriceLevels&
+PriceLadder&
 OrderBook::get_asks()
 {
     return m_asks;
 }
 
-PriceLevels&
+PriceLadder&
 OrderBook::get_price_levels(LevelType level_type)
 {
     return level_type == LevelType::BID ? m_bids : m_asks;
 }
 
 /**
- * @brief Get the best bid in constant-time.
+ * @brief Get the trigger index of the pending stop orders of @a side. Buy
+ * stops trigger from the lowest stop price up, like asks, and sell stops from
+ * the highest down, like bids.
  */
-const PriceLevel&
-OrderBook::get_best_bid() const
+PriceLadder&
+OrderBook::get_stop_levels(Side side)
 {
-    return m_bids.back();
+    return side == 'B' ? m_buy_stops : m_sell_stops;
 }
 
 /**
- * @brief Get the best ask in constant-time.
+ * @brief Get the price of the last trade, if any.
  */
-PriceLevel&
-OrderBook::get_best_bid()
+std::optional<Price>
+OrderBook::get_last_trade_price() const
 {
-    return m_bids.back();
+    return m_last_trade_price;
 }
 
+/**
+ * @brief Get the best bid in constant-time.
+ */
 const PriceLevel&
-OrderBook::get_best_ask() const
+OrderBook::get_best_bid() const
 {
-    return m_asks.back();
+    return m_bids.best();
 }
 
 PriceLevel&
-OrderBook::get_best_ask()
+OrderBook::get_best_bid()
 {
-    return m_asks.back();
+    return m_bids.best();
 }
 
 /**
- * @brief Perform a binary search
- * and get an iterator to the price level in O(log n) time
+ * @brief Get the best ask in constant-time.
  */
-auto
-OrderBook::get_price_level_iter(LevelType level_type, Price price)
+const PriceLevel&
+OrderBook::get_best_ask() const
 {
-    PriceLevels& price_levels = level_type == LevelType::BID ? m_bids : m_asks;
-
-    PriceLevels::iterator pos{};
-
-    if (level_type == LevelType::BID) {
-        // m_bids.back() is the highest bid
-        pos = std::lower_bound(price_levels.begin(),
-                               price_levels.end(),
-                               price,
-                               [](PriceLevel& price_level, Price value) {
-                                   return price_level.get_price() < value;
-                               });
-    } else {
-        // m_asks.back() is the lowest ask
-
-        pos = std::lower_bound(price_levels.begin(),
-                               price_levels.end(),
-                               price,
-                               [](PriceLevel& price_level, Price value) {
-                                   return price_level.get_price() > value;
-                               });
-    }
-
-    if (pos != price_levels.end())
-        if (pos->get_price() != price)
-            return price_levels.end();
+    return m_asks.best();
+}
 
-    return pos;
+PriceLevel&
+OrderBook::get_best_ask()
+{
+    return m_asks.best();
 }
 
 /**
- * @brief Get the bid price level for user-supplied @a price.
+ * @brief Get the bid price level for user-supplied @a price in constant-time.
  */
 PriceLevel&
 OrderBook::get_bid_price_level(Price price)
 {
-    auto it = get_price_level_iter(LevelType::BID, price);
-    if (it == m_bids.end()) {
+    PriceLevel* price_level = m_bids.find(price);
+    if (price_level == nullptr) {
         throw std::logic_error(std::format("Price level {} not found!", price));
     }
 
-    return *it;
+    return *price_level;
 }
 
 /**
- * @brief Get the ask price level for user-supplied @a price.
+ * @brief Get the ask price level for user-supplied @a price in constant-time.
  */
 PriceLevel&
 OrderBook::get_ask_price_level(Price price)
 {
-    auto it = get_price_level_iter(LevelType::ASK, price);
-    if (it == m_asks.end()) {
+    PriceLevel* price_level = m_asks.find(price);
+    if (price_level == nullptr) {
         throw std::logic_error(std::format("Price level {} not found!", price));
     }
 
-    return *it;
+    return *price_level;
 }
 
 /**
@@ -157,12 +149,162 @@ OrderBook::get_price_level(LevelType level_type, Price price)
 }
 
 /**
- * @brief Get the free-list of indices.
+ * @brief Get the listener notified of every fill, or nullptr.
+ */
+TradeListener*
+OrderBook::get_trade_listener()
+{
+    return m_trade_listener;
+}
+
+/**
+ * @brief Get the queue receiving the market data feed, or nullptr.
+ */
+MarketDataQueue*
+OrderBook::get_market_data_queue()
+{
+    return m_market_data_queue;
+}
+
+/**
+ * @brief Number of market data events lost because the queue was full.
+ */
+uint64_t
+OrderBook::get_dropped_event_count() const
+{
+    return m_dropped_event_count;
+}
+
+/**
+ * @brief Units of expiry work done so far, as charged to the budget of
+ * @a expire_orders.
  */
-std::deque<SeqNum>&
-OrderBook::get_free_list()
+uint64_t
+OrderBook::get_expiry_work_done() const
 {
-    return m_free_list;
+    return m_expiry_wheel.get_work_done();
+}
+
+/**
+ * @brief Get the pool storing the orders of this book.
+ */
+OrderPool&
+OrderBook::get_order_pool()
+{
+    return m_order_pool;
+}
+
+/**
+ * @brief Write the price, open quantity and order count of the best levels of
+ * the @a level_type side to @a depth_levels, best first. Returns the number of
+ * levels written, which is less than the size of @a depth_levels when the side
+ * has fewer occupied levels. Each level costs O(1), no order is visited.
+ */
+std::size_t
+OrderBook::get_depth(LevelType level_type, std::span<DepthLevel> depth_levels)
+{
+    PriceLadder& price_ladder = get_price_levels(level_type);
+    if (price_ladder.empty())
+        return 0;
+
+    std::size_t num_levels{ 0 };
+    for (PriceLevel* price_level = &price_ladder.best();
+         price_level != nullptr && num_levels < depth_levels.size();
+         price_level = price_ladder.next_level(*price_level)) {
+        depth_levels[num_levels++] =
+          DepthLevel{ .price = price_level->get_price(),
+                      .quantity = price_level->get_total_quantity(),
+                      .order_count = price_level->get_order_count() };
+    }
+    return num_levels;
+}
+
+/**
+ * @brief Total open quantity on the @a level_type side at @a price or better.
+ */
+Quantity
+OrderBook::get_cumulative_quantity(LevelType level_type, Price price)
+{
+    PriceLadder& price_ladder = get_price_levels(level_type);
+    if (price_ladder.empty())
+        return 0;
+
+    Quantity quantity{ 0 };
+    for (PriceLevel* price_level = &price_ladder.best(); price_level != nullptr;
+         price_level = price_ladder.next_level(*price_level)) {
+        bool is_at_or_better = level_type == LevelType::BID
+                                 ? price_level->get_price() >= price
+                                 : price_level->get_price() <= price;
+        if (!is_at_or_better)
+            break;
+
+        quantity += price_level->get_total_quantity();
+    }
+    return quantity;
+}
+
+/**
+ * @brief Average price at which an order on @a side for @a quantity would be
+ * filled by sweeping the opposite side of the book, or std::nullopt if the
+ * opposite side does not hold that much quantity.
+ */
+std::optional<double>
+OrderBook::get_average_fill_price(Side side, Quantity quantity)
+{
+    PriceLadder& opposite_ladder = side == 'B' ? m_asks : m_bids;
+    if (quantity == 0 || opposite_ladder.empty())
+        return std::nullopt;
+
+    Quantity remaining_quantity = quantity;
+    double notional{ 0.0 };
+    for (PriceLevel* price_level = &opposite_ladder.best(); price_level != nullptr;
+         price_level = opposite_ladder.next_level(*price_level)) {
+        Quantity fill_quantity =
+          std::min(remaining_quantity, price_level->get_total_quantity());
+        notional += static_cast<double>(price_level->get_price()) *
+                    static_cast<double>(fill_quantity);
+        remaining_quantity -= fill_quantity;
+
+        if (remaining_quantity == 0)
+            return notional / static_cast<double>(quantity);
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Check, without modifying the book, that an order on @a side could be
+ * filled for @a quantity at @a price or better. Reads the aggregate quantity of
+ * each level it crosses and stops as soon as enough is found.
+ */
+bool
+OrderBook::has_liquidity(Side side, Price price, Quantity quantity)
+{
+    PriceLadder& opposite_ladder = side == 'B' ? m_asks : m_bids;
+    if (opposite_ladder.empty())
+        return false;
+
+    Quantity available_quantity{ 0 };
+    for (PriceLevel* price_level = &opposite_ladder.best(); price_level != nullptr;
+         price_level = opposite_ladder.next_level(*price_level)) {
+        bool is_crossing = side == 'B' ? price_level->get_price() <= price
+                                       : price_level->get_price() >= price;
+        if (!is_crossing)
+            return false;
+
+        available_quantity += price_level->get_total_quantity();
+        if (available_quantity >= quantity)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Check whether an order scheduled to expire is due at or before @a now.
+ */
+bool
+OrderBook::has_expired_orders(Timestamp now) const
+{
+    return m_expiry_wheel.has_expired(now);
 }
 
 bool
@@ -172,43 +314,44 @@ OrderBook::is_match_possible(Side side, Price price)
         if (m_asks.empty())
             return false;
 
-        if (price < m_asks.back().get_price())
-            return false;
-
-        if (m_asks.back().is_empty())
+        if (price < m_asks.best().get_price())
             return false;
     } else {
         if (m_bids.empty())
             return false;
 
-        if (price > m_bids.back().get_price())
-            return false;
-
-        if (m_bids.back().is_empty())
+        if (price > m_bids.best().get_price())
             return false;
     }
     return true;
 }
 
+/**
+ * @brief Check in O(1) that @a order_id refers to a resting order. Handles to
+ * orders that have since been filled or cancelled are rejected, even if their
+ * slot has been reused.
+ */
 bool
 OrderBook::order_exists(OrderId order_id)
 {
-    if (order_id.seq_num == 0 || order_id.seq_num > m_order_pool.size())
-        return false;
-
-    OrderNode& order_node = m_order_pool[order_id.seq_num];
-    auto& order_opt = order_node.order;
-    if (!order_opt.has_value())
-        return false;
-
-    return true;
+    return m_order_pool.is_live(order_id);
 }
 
 // Order management API
 /**
- * @brief Add an order to the order_book
+ * @brief Add an order to the order_book.
+ *
+ * The incoming order is the aggressor: it walks the opposite side from the best
+ * level for as long as it crosses, and only its remainder is rested on its own
+ * side. A non-crossing limit order costs a single price comparison.
+ *
+ * MARKET and FILL_AND_KILL remainders are not rested. A FILL_OR_KILL order is
+ * only matched if the opposite side holds its full quantity at or better than
+ * its limit. Returns the id assigned to the order, or an id with seq_num 0 if
+ * the order was dropped without trading. Stop orders that the resulting trades
+ * trigger are executed before returning.
  */
-void
+OrderId
 OrderBook::add_order(OrderType order_type,
                      UserId user_id,
                      Side side,
@@ -216,185 +359,338 @@ OrderBook::add_order(OrderType order_type,
                      Price price,
                      Quantity quantity)
 {
-
-    // Handling for MARKET orders
-    if (order_type == OrderType::MARKET) {
-        if (side == 'B' and !m_asks.empty()) {
-            PriceLevel& worst_ask = m_asks.front();
-            // Convert to a limit order with worst ask price
-            order_type = OrderType::LIMIT;
-            price = std::numeric_limits<Price>::max();
-        } else if (side == 'S' and !m_bids.empty()) {
-            PriceLevel& worst_bid = m_bids.front();
-            // Convert to a limit order with worst bid price
-            order_type = OrderType::LIMIT;
-            price = std::numeric_limits<Price>::min();
-        } else {
-            return;
-        }
-    }
+    if (order_type == OrderType::STOP || order_type == OrderType::STOP_LIMIT)
+        throw std::logic_error("Stop orders need a stop price, see add_stop_order");
 
     LevelType level_type = side == 'B' ? LevelType::BID : LevelType::ASK;
-    PriceLevels& price_levels = level_type == LevelType::BID ? m_bids : m_asks;
-    PriceLevels::iterator it = get_price_level_iter(level_type, price);
+    PriceLadder& price_ladder = get_price_levels(level_type);
+
+    // MARKET orders are priced at the edge of the price ladder
+    if (order_type == OrderType::MARKET)
+        price =
+          side == 'B' ? price_ladder.get_max_price() : price_ladder.get_min_price();
+
+    // Validates the price before anything is written
+    price_ladder.at(price);
+
+    if (is_immediate(order_type) && !is_match_possible(side, price))
+        return OrderId{};
+
+    // A FILL_OR_KILL order that cannot be filled in full is rejected before
+    // anything is written, not even its order id
+    if (order_type == OrderType::FILL_OR_KILL && !has_liquidity(side, price, quantity))
+        return OrderId{};
+
+    Order order{ .order_id = generate_order_id(symbol_name),
+                 .user_id = user_id,
+                 .order_type = order_type,
+                 .side = side,
+                 .price = price,
+                 .initial_quantity = quantity,
+                 .remaining_quantity = quantity,
+                 .stop_price = 0 };
+
+    process_order(order);
+    if (order_type == OrderType::GOOD_FOR_DAY && m_session_close_time.has_value() &&
+        order_exists(order.order_id))
+        m_expiry_wheel.schedule(order.order_id, *m_session_close_time);
+
+    trigger_stops();
+    return order.order_id;
+}
+
+/**
+ * @brief Add a STOP or STOP_LIMIT order. It is held in the trigger index of
+ * its side until a trade prints at or through @a stop_price (at or above for a
+ * buy stop, at or below for a sell stop), then enters the matching path as a
+ * MARKET order (STOP) or as a LIMIT order at @a price (STOP_LIMIT), keeping
+ * its id. A stop already crossed by the last trade price triggers at once.
+ *
+ * Pending stops are not part of the visible book: they publish no market data
+ * and are not matched against.
+ */
+OrderId
+OrderBook::add_stop_order(OrderType order_type,
+                          UserId user_id,
+                          Side side,
+                          std::string_view symbol_name,
+                          Price stop_price,
+                          Price price,
+                          Quantity quantity)
+{
+    if (order_type != OrderType::STOP && order_type != OrderType::STOP_LIMIT)
+        throw std::logic_error("Only STOP and STOP_LIMIT orders have a stop price");
+
+    PriceLadder& price_ladder = get_price_levels(side == 'B' ? LevelType::BID
+                                                             : LevelType::ASK);
+    if (order_type == OrderType::STOP)
+        price =
+          side == 'B' ? price_ladder.get_max_price() : price_ladder.get_min_price();
+
+    // Validates both prices before anything is written
+    price_ladder.at(price);
+    PriceLadder& stop_ladder = get_stop_levels(side);
+    PriceLevel& stop_level = stop_ladder.at(stop_price);
+
+    Order order{ .order_id = generate_order_id(symbol_name),
+                 .user_id = user_id,
+                 .order_type = order_type,
+                 .side = side,
+                 .price = price,
+                 .initial_quantity = quantity,
+                 .remaining_quantity = quantity,
+                 .stop_price = stop_price };
+
+    stop_level.push_back(order);
+    stop_ladder.mark_occupied(stop_level);
+    trigger_stops();
+    return order.order_id;
+}
 
-    if (it == price_levels.end()) {
-        add_price_level(level_type, price);
-        it = get_price_level_iter(level_type, price);
+/**
+ * @brief Amend the price and open quantity of a resting order, keeping its id.
+ *
+ * Reducing the quantity at the same price keeps the order's queue position and
+ * costs O(1). Increasing the quantity or changing the price loses priority:
+ * the node is unlinked and re-enters the matching path from the same pool slot,
+ * so it trades if the new price crosses and otherwise joins the back of the
+ * queue at the new price. The L3 feed reports the latter as a cancel followed
+ * by an add with the same id. A new quantity of 0 cancels the order.
+ *
+ * A pending stop keeps its stop price. @a new_price is the limit price of a
+ * STOP_LIMIT, and is ignored for a STOP, which has no price of its own, as in
+ * add_stop_order.
+ */
+void
+OrderBook::modify_order(OrderId order_id, Price new_price, Quantity new_quantity)
+{
+    Order& order = get_order(order_id);
+    if (new_quantity == 0) {
+        cancel_order(order_id);
+        return;
     }
 
-    PriceLevel& price_level = *it;
-    OrderId order_id = generate_order_id(symbol_name);
+    if (is_pending_stop(order)) {
+        modify_stop_order(order, new_price, new_quantity);
+        return;
+    }
 
-    if (order_type == OrderType::FILL_AND_KILL && !is_match_possible(side, price))
+    PriceLadder& price_ladder =
+      get_price_levels(order.side == 'B' ? LevelType::BID : LevelType::ASK);
+    PriceLevel& price_level = price_ladder.at(order.price);
+
+    if (new_price == order.price && new_quantity <= order.remaining_quantity) {
+        price_level.modify_order(order_id.seq_num, new_quantity);
+        publish_order_event(
+          MarketDataEventType::ORDER_MODIFIED, order, new_price, new_quantity);
+        publish_level_event(price_level);
         return;
+    }
+
+    // Validates the new price before anything is written
+    price_ladder.at(new_price);
+
+    Order amended_order = order;
+    amended_order.price = new_price;
+    amended_order.initial_quantity =
+      order.initial_quantity - order.remaining_quantity + new_quantity;
+    amended_order.remaining_quantity = new_quantity;
 
-    price_level.push_back(Order{ .order_type = order_type,
-                                 .order_id = order_id,
-                                 .user_id = user_id,
-                                 .side = side,
-                                 .price = price,
-                                 .initial_quantity = quantity,
-                                 .remaining_quantity = quantity });
-    match();
+    publish_order_event(MarketDataEventType::ORDER_CANCELLED, order, order.price, 0);
+    price_level.unlink(order_id.seq_num);
+    if (price_level.is_empty())
+        price_ladder.mark_empty(price_level);
+    publish_level_event(price_level);
+
+    process_order(amended_order);
+    trigger_stops();
 }
 
 void
-OrderBook::modify_order(OrderId order_id, Price new_price, Quantity new_quantity)
+OrderBook::cancel_order(OrderId order_id)
 {
-    Order& old_order = get_order(order_id);
-    OrderType order_type = old_order.order_type;
-    UserId user_id = old_order.user_id;
-    Side side = old_order.side;
-    LevelType level_type = old_order.side == 'B' ? LevelType::BID : LevelType::ASK;
-    PriceLevel& price_level = get_price_level(level_type, old_order.price);
+    if (!order_exists(order_id))
+        throw std::logic_error(std::format("OrderId {} does not exist!", order_id));
 
-    if (old_order.price == new_price) {
-        old_order.initial_quantity = new_quantity;
-        old_order.remaining_quantity = new_quantity;
+    const Order& order = m_order_pool[order_id.seq_num].order;
+    if (is_pending_stop(order)) {
+        PriceLadder& stop_ladder = get_stop_levels(order.side);
+        PriceLevel& stop_level = stop_ladder.at(order.stop_price);
+        stop_level.erase(order_id.seq_num);
+        if (stop_level.is_empty())
+            stop_ladder.mark_empty(stop_level);
         return;
     }
 
-    cancel_order(order_id);
+    PriceLadder& price_ladder =
+      get_price_levels(order.side == 'B' ? LevelType::BID : LevelType::ASK);
+    PriceLevel& price_level = price_ladder.at(order.price);
+
+    publish_order_event(MarketDataEventType::ORDER_CANCELLED, order, order.price, 0);
+    price_level.erase(order_id.seq_num);
+    if (price_level.is_empty())
+        price_ladder.mark_empty(price_level);
+    publish_level_event(price_level);
+}
 
-    add_order(order_type, user_id, side, order_id.symbol_name, new_price, new_quantity);
+/**
+ * @brief Cancel every resting order and pending stop of @a user_id, on
+ * @a side only if it is set. Visits each order of the book once. Returns the
+ * number of orders cancelled.
+ */
+std::size_t
+OrderBook::mass_cancel(UserId user_id, std::optional<Side> side)
+{
+    std::size_t num_cancelled{ 0 };
+    for (PriceLadder* price_ladder : { &m_bids, &m_asks, &m_buy_stops, &m_sell_stops }) {
+        if (price_ladder->empty())
+            continue;
+
+        for (PriceLevel* price_level = &price_ladder->best(); price_level != nullptr;
+             price_level = price_ladder->next_level(*price_level)) {
+            SeqNum seq_num = price_level->get_first_seq_num();
+            while (seq_num != 0) {
+                const OrderNode& order_node = m_order_pool[seq_num];
+                SeqNum next_seq_num = order_node.next;
+                const Order& order = order_node.order;
+                if (order.user_id == user_id && (!side || order.side == *side)) {
+                    cancel_order(order.order_id);
+                    ++num_cancelled;
+                }
+                seq_num = next_seq_num;
+            }
+        }
+    }
+    return num_cancelled;
 }
 
+// Batch API
+/**
+ * @brief Add a batch of orders, all for this book, in sequence. The outcome of
+ * @a order_requests[i] is written to @a results[i]; a rejected request does not
+ * stop the batch. Performs no heap allocation once the order pool is warm.
+ */
 void
-OrderBook::cancel_order(OrderId order_id)
+OrderBook::add_orders(std::span<const OrderRequest> order_requests,
+                      std::span<CommandResult> results)
 {
-    if (!order_exists(order_id))
-        throw std::logic_error(std::format("OrderId {} does not exist!", order_id));
+    if (results.size() < order_requests.size())
+        throw std::logic_error("Result buffer is smaller than the batch!");
 
-    OrderNode& order_node = m_order_pool[order_id.seq_num];
-    if (order_node.prev = 0 || order_node.next == 0) {
-        // if(!order_node.order.has_value())
+    for (std::size_t i{ 0 }; i < order_requests.size(); ++i)
+        results[i] = try_add_order(order_requests[i]);
+}
+
+/**
+ * @brief Cancel a batch of orders of this book, see @a add_orders.
+ */
+void
+OrderBook::cancel_orders(std::span<const OrderId> order_ids,
+                         std::span<CommandResult> results)
+{
+    if (results.size() < order_ids.size())
+        throw std::logic_error("Result buffer is smaller than the batch!");
+
+    for (std::size_t i{ 0 }; i < order_ids.size(); ++i)
+        results[i] = try_cancel_order(order_ids[i]);
+}
+
+/**
+ * @brief Apply a batch of mixed commands for this book in sequence,
+ * see @a add_orders.
+ */
+void
+OrderBook::process_commands(std::span<const Command> commands,
+                            std::span<CommandResult> results)
+{
+    if (results.size() < commands.size())
+        throw std::logic_error("Result buffer is smaller than the batch!");
+
+    for (std::size_t i{ 0 }; i < commands.size(); ++i) {
+        const Command& command = commands[i];
+        switch (command.command_type) {
+            case CommandType::ADD_ORDER:
+                results[i] = try_add_order(command.order_request);
+                break;
+            case CommandType::MODIFY_ORDER:
+                results[i] = try_modify_order(
+                  command.order_id, command.new_price, command.new_quantity);
+                break;
+            case CommandType::CANCEL_ORDER:
+                results[i] = try_cancel_order(command.order_id);
+                break;
+        }
     }
-    OrderNode& prev_node = m_order_pool[order_node.prev];
-    OrderNode& next_node = m_order_pool[order_node.next];
-    prev_node.next = order_node.next;
-    next_node.prev = order_node.prev;
-    order_node.prev = 0;
-    order_node.next = 0;
-    m_free_list.push_back(order_id.seq_num);
-    order_node.order = std::nullopt;
 }
 
 /**
  * @brief The global match method attempts match orders
  * in priority of (price, arrival time).
+ *
+ * Continuous trading matches each incoming order as it arrives, see
+ * @a add_order. This sweep uncrosses a book built in auction mode.
  */
 void
 OrderBook::match()
 {
-    Trades trades{};
-
     while (true) {
         if (m_bids.empty() || m_asks.empty())
             break;
 
-        PriceLevel& best_bid_price_level = m_bids.back();
-        PriceLevel& best_ask_price_level = m_asks.back();
+        PriceLevel& best_bid_price_level = m_bids.best();
+        PriceLevel& best_ask_price_level = m_asks.best();
 
         if (best_bid_price_level.get_price() < best_ask_price_level.get_price())
             break;
 
         while (!best_bid_price_level.is_empty() && !best_ask_price_level.is_empty()) {
-            auto& bid_ = best_bid_price_level.front();
-            auto& ask_ = best_ask_price_level.front();
+            Order& bid_ = best_bid_price_level.front();
+            Order& ask_ = best_ask_price_level.front();
 
             Quantity fill_quantity =
               std::min(bid_.remaining_quantity, ask_.remaining_quantity);
-
-            auto& executing_order = bid_;
-            auto& reducing_order = ask_;
-
-            if (executing_order.remaining_quantity > reducing_order.remaining_quantity) {
-                std::swap(executing_order, reducing_order);
-            }
-
-            OrderId executing_order_id = executing_order.order_id;
-            OrderId reducing_order_id = reducing_order.order_id;
-            FillType reducing_order_fill_type =
-              (fill_quantity == reducing_order.remaining_quantity &&
-               reducing_order.initial_quantity == reducing_order.remaining_quantity)
-                ? FillType::Full
-                : FillType::Partial;
-
-            if (executing_order.order_id.seq_num == bid_.order_id.seq_num) {
-                best_bid_price_level.fill_order(reducing_order);
-
-                if (reducing_order.remaining_quantity == 0) {
-                    best_ask_price_level.pop_front();
-                }
-            } else {
-                best_ask_price_level.fill_order(reducing_order);
-                if (reducing_order.remaining_quantity == 0) {
-                    best_bid_price_level.pop_front();
-                }
-            }
-
-            TradeInfo executing_order_fill_info = TradeInfo{
-                .fill_type = FillType::Full,
-                .user_id = executing_order.user_id,
-                .order_id = executing_order.order_id,
-                .price = executing_order.price,
-                .quantity = fill_quantity,
-            };
-
-            TradeInfo reducing_order_fill_info =
-              TradeInfo{ .fill_type = reducing_order_fill_type,
-                         .user_id = reducing_order.user_id,
-                         .order_id = reducing_order.order_id,
-                         .price = reducing_order.price,
-                         .quantity = fill_quantity };
-
-            std::string out1_ =
-              std::format("executing_order_fill_info={}", executing_order_fill_info);
-            std::string out2_ =
-              std::format("reducing_order_fill_info={}", reducing_order_fill_info);
-
-            std::cout << "\n" << out1_;
-            std::cout << "\n" << out2_;
-            std::cout << "\n";
-
-            trades.push_back(
-              Trade{ executing_order_fill_info, reducing_order_fill_info });
+            best_bid_price_level.fill_order(fill_quantity);
+            best_ask_price_level.fill_order(fill_quantity);
+
+            // The executing order is the one this fill completes, the reducing
+            // order is the one left with (possibly) open quantity.
+            bool is_bid_executing = bid_.remaining_quantity == 0;
+            const Order& executing_order = is_bid_executing ? bid_ : ask_;
+            const Order& reducing_order = is_bid_executing ? ask_ : bid_;
+
+            m_last_trade_price = executing_order.price;
+
+            // Each side is reported at its own limit price
+            publish_trade(
+              make_fill_info(executing_order, executing_order.price, fill_quantity),
+              make_fill_info(reducing_order, reducing_order.price, fill_quantity));
+            publish_order_event(
+              MarketDataEventType::ORDER_EXECUTED, bid_, bid_.price, fill_quantity);
+            publish_order_event(
+              MarketDataEventType::ORDER_EXECUTED, ask_, ask_.price, fill_quantity);
+
+            if (bid_.remaining_quantity == 0)
+                best_bid_price_level.pop_front();
+            if (ask_.remaining_quantity == 0)
+                best_ask_price_level.pop_front();
         }
 
         if (best_bid_price_level.is_empty()) {
-            m_bids.pop_back();
+            m_bids.mark_empty(best_bid_price_level);
         }
 
         if (best_ask_price_level.is_empty()) {
-            m_asks.pop_back();
+            m_asks.mark_empty(best_ask_price_level);
         }
+
+        publish_level_event(best_bid_price_level);
+        publish_level_event(best_ask_price_level);
     }
 
     // Any FillAndKill orders that were only partially filled
     // should be deleted from the order book
     if (!m_bids.empty()) {
-        auto& best_bid_price_level = m_bids.back();
+        auto& best_bid_price_level = m_bids.best();
         auto& bid_ = best_bid_price_level.front();
         if (bid_.order_type == OrderType::FILL_AND_KILL) {
             cancel_order(bid_.order_id);
@@ -402,85 +698,462 @@ OrderBook::match()
     }
 
     if (!m_asks.empty()) {
-        auto& best_ask_price_level = m_asks.back();
+        auto& best_ask_price_level = m_asks.best();
         auto& ask_ = best_ask_price_level.front();
         if (ask_.order_type == OrderType::FILL_AND_KILL) {
             cancel_order(ask_.order_id);
         }
     }
+
+    trigger_stops();
 }
 
+/**
+ * @brief Register the listener notified of every fill. Pass nullptr
+ * to detach it. The listener must outlive the order book.
+ */
 void
-OrderBook::add_price_level(LevelType level_type, Price price)
+OrderBook::set_trade_listener(TradeListener* trade_listener)
 {
-    PriceLevels& price_levels = level_type == LevelType::BID ? m_bids : m_asks;
-    PriceLevels::iterator pos = find_insert_location(price_levels, level_type, price);
-    price_levels.insert(pos, PriceLevel{ level_type, price, *this });
+    m_trade_listener = trade_listener;
 }
 
+/**
+ * @brief Attach the queue receiving the L2/L3 market data feed of this book.
+ * Pass nullptr to detach it. The book is the single producer; when the queue
+ * is full the event is dropped and counted, the book never blocks. The queue
+ * must outlive the order book.
+ */
 void
-OrderBook::delete_price_level(LevelType level_type, Price price)
+OrderBook::set_market_data_queue(MarketDataQueue* market_data_queue)
 {
-    PriceLevels& price_levels = level_type == LevelType::BID ? m_bids : m_asks;
-    PriceLevels::iterator pos = get_price_level_iter(level_type, price);
-    price_levels.erase(pos);
+    m_market_data_queue = market_data_queue;
 }
 
-SeqNum
-OrderBook::get_next_seq_num()
+/**
+ * @brief In auction mode incoming orders are rested without matching,
+ * until @a match is called to uncross the book.
+ */
+void
+OrderBook::set_auction_mode(bool is_auction_mode)
 {
-    SeqNum next_seq_num{};
-    if (!m_free_list.empty()) {
-        next_seq_num = m_free_list.front();
-        m_free_list.pop_front();
-    } else {
-        next_seq_num = m_order_pool.size();
+    m_is_auction_mode = is_auction_mode;
+}
+
+// Expiry
+/**
+ * @brief Set the time at which GOOD_FOR_DAY orders rested from now on expire,
+ * e.g. when rolling over to the next session.
+ */
+void
+OrderBook::set_session_close_time(Timestamp session_close_time)
+{
+    m_session_close_time = session_close_time;
+}
+
+/**
+ * @brief Schedule the resting order @a order_id to be cancelled at
+ * @a expire_time, in O(1).
+ */
+void
+OrderBook::schedule_expiry(OrderId order_id, Timestamp expire_time)
+{
+    if (!order_exists(order_id))
+        throw std::logic_error(std::format("OrderId {} does not exist!", order_id));
+
+    m_expiry_wheel.schedule(order_id, expire_time);
+}
+
+/**
+ * @brief Cancel the orders due to expire at or before @a now, in expiry order.
+ *
+ * At most @a max_orders units of expiry work are done per call, so that a
+ * session close expiring millions of orders is spread over many short slices
+ * between which the book keeps matching. Handing out an entry and moving one
+ * down the timer wheel both count as a unit, and entries of orders that have
+ * since been filled or cancelled are skipped but count too. Call again while
+ * @a has_expired_orders returns true. Returns the number of orders cancelled.
+ */
+std::size_t
+OrderBook::expire_orders(Timestamp now, std::size_t max_orders)
+{
+    std::array<OrderId, 64> expired_ids;
+    std::size_t num_cancelled{ 0 };
+    uint64_t first_work_done = m_expiry_wheel.get_work_done();
+
+    while (m_expiry_wheel.has_expired(now)) {
+        std::size_t work_done = m_expiry_wheel.get_work_done() - first_work_done;
+        if (work_done >= max_orders)
+            break;
+
+        std::size_t batch_size = std::min(max_orders - work_done, expired_ids.size());
+        std::size_t num_expired = m_expiry_wheel.collect_expired(
+          now, std::span<OrderId>(expired_ids).first(batch_size));
+
+        for (std::size_t i{ 0 }; i < num_expired; ++i) {
+            if (order_exists(expired_ids[i])) {
+                cancel_order(expired_ids[i]);
+                ++num_cancelled;
+            }
+        }
     }
-    return next_seq_num;
+    return num_cancelled;
 }
 
-OrderId
-OrderBook::generate_order_id(std::string_view symbol_name)
+// Snapshots
+namespace {
+/**
+ * @brief The counters and flags of a book as saved in a snapshot.
+ */
+struct BookRecord
 {
-    OrderId order_id{ .symbol_name = "", .seq_num = get_next_seq_num() };
-    strcpy(order_id.symbol_name, std::string(symbol_name).c_str());
-    return order_id;
+    Price last_trade_price;
+    uint64_t event_seq_num;
+    uint64_t dropped_event_count;
+    Timestamp session_close_time;
+    bool has_last_trade_price;
+    bool has_session_close_time;
+    bool is_auction_mode;
+};
 }
 
 /**
- * @brief Helper function to find the location in vector<PriceLevel>
- * where the user-supplied @a price must be inserted.
+ * @brief Write the state of the book: its counters, the order pool, the four
+ * ladders and the expiry wheel. Listeners and the market data queue are not
+ * part of the state.
  */
-PriceLevels::iterator
-OrderBook::find_insert_location(PriceLevels& price_levels,
-                                LevelType level_type,
-                                Price price)
+void
+OrderBook::save_snapshot(SnapshotWriter& writer) const
 {
-    // Empty queue
-    if (price_levels.size() == 0)
-        return price_levels.end();
+    writer.write(
+      BookRecord{ .last_trade_price = m_last_trade_price.value_or(0),
+                  .event_seq_num = m_event_seq_num,
+                  .dropped_event_count = m_dropped_event_count,
+                  .session_close_time = m_session_close_time.value_or(0),
+                  .has_last_trade_price = m_last_trade_price.has_value(),
+                  .has_session_close_time = m_session_close_time.has_value(),
+                  .is_auction_mode = m_is_auction_mode });
+    m_order_pool.save_snapshot(writer);
+    m_bids.save_snapshot(writer);
+    m_asks.save_snapshot(writer);
+    m_buy_stops.save_snapshot(writer);
+    m_sell_stops.save_snapshot(writer);
+    m_expiry_wheel.save_snapshot(writer);
+}
 
-    PriceLevels::iterator pos;
+/**
+ * @brief Restore a book saved by @a save_snapshot into this new one, built
+ * with the same tick grid. Orders keep their ids and queue positions.
+ */
+void
+OrderBook::load_snapshot(SnapshotReader& reader)
+{
+    auto book_record = reader.read<BookRecord>();
+    m_order_pool.load_snapshot(reader);
+    m_bids.load_snapshot(reader);
+    m_asks.load_snapshot(reader);
+    m_buy_stops.load_snapshot(reader);
+    m_sell_stops.load_snapshot(reader);
+    m_expiry_wheel.load_snapshot(reader);
+
+    m_last_trade_price.reset();
+    if (book_record.has_last_trade_price)
+        m_last_trade_price = book_record.last_trade_price;
+    m_session_close_time.reset();
+    if (book_record.has_session_close_time)
+        m_session_close_time = book_record.session_close_time;
+    m_event_seq_num = book_record.event_seq_num;
+    m_dropped_event_count = book_record.dropped_event_count;
+    m_is_auction_mode = book_record.is_auction_mode;
+}
 
-    if (level_type == LevelType::BID) {
-        // m_bids.back() is the highest bid
-        pos = std::lower_bound(price_levels.begin(),
-                               price_levels.end(),
-                               price,
-                               [](PriceLevel& price_level, Price value) {
-                                   return price_level.get_price() < value;
-                               });
-    } else {
-        // m_asks.back() is the lowest ask
-        pos = std::lower_bound(price_levels.begin(),
-                               price_levels.end(),
-                               price,
-                               [](PriceLevel& price_level, Price value) {
-                                   return price_level.get_price() > value;
-                               });
+/**
+ * @brief Match @a order as an aggressor and rest its remainder, if its type
+ * allows it. In auction mode the order is rested without matching.
+ */
+void
+OrderBook::process_order(Order& order)
+{
+    if (!m_is_auction_mode) {
+        match_aggressor(order);
+
+        if (order.remaining_quantity == 0 || is_immediate(order.order_type)) {
+            // Nothing to rest, the slot goes straight back to the free list
+            m_order_pool.release(order.order_id.seq_num);
+            return;
+        }
+    }
+
+    PriceLadder& price_ladder =
+      get_price_levels(order.side == 'B' ? LevelType::BID : LevelType::ASK);
+    PriceLevel& price_level = price_ladder.at(order.price);
+    price_level.push_back(order);
+    price_ladder.mark_occupied(price_level);
+
+    publish_order_event(
+      MarketDataEventType::ORDER_ADDED, order, order.price, order.remaining_quantity);
+    publish_level_event(price_level);
+}
+
+/**
+ * @brief Execute the stop orders crossed by the last trade price, one at a
+ * time, until none is left.
+ *
+ * Only the best level of each trigger index is examined. The trades of a
+ * triggered order move the last trade price and may trigger further stops;
+ * the cascade is handled by this loop rather than by recursion. The order is
+ * deterministic: buy stops before sell stops, lower buy stop prices (higher
+ * sell stop prices) first, then arrival time. Triggered orders keep their
+ * pool slot, so no allocation takes place.
+ */
+void
+OrderBook::trigger_stops()
+{
+    while (m_last_trade_price.has_value()) {
+        Price last_trade_price = *m_last_trade_price;
+        PriceLadder* stop_ladder = nullptr;
+        if (!m_buy_stops.empty() && m_buy_stops.best().get_price() <= last_trade_price)
+            stop_ladder = &m_buy_stops;
+        else if (!m_sell_stops.empty() &&
+                 m_sell_stops.best().get_price() >= last_trade_price)
+            stop_ladder = &m_sell_stops;
+        else
+            break;
+
+        PriceLevel& stop_level = stop_ladder->best();
+        SeqNum seq_num = stop_level.get_first_seq_num();
+        Order order = stop_level.front();
+        stop_level.unlink(seq_num);
+        if (stop_level.is_empty())
+            stop_ladder->mark_empty(stop_level);
+
+        order.order_type =
+          order.order_type == OrderType::STOP ? OrderType::MARKET : OrderType::LIMIT;
+        process_order(order);
+    }
+}
+
+/**
+ * @brief Walk the opposite side of the book with an incoming @a aggressor,
+ * filling resting orders in price-time priority at their price, until the
+ * aggressor is filled or no longer crosses. The aggressor's own side is not
+ * touched.
+ */
+void
+OrderBook::match_aggressor(Order& aggressor)
+{
+    PriceLadder& opposite_ladder = aggressor.side == 'B' ? m_asks : m_bids;
+
+    while (aggressor.remaining_quantity != 0 && !opposite_ladder.empty()) {
+        PriceLevel& price_level = opposite_ladder.best();
+        if (!price_level.can_fill(aggressor))
+            break;
+
+        while (aggressor.remaining_quantity != 0 && !price_level.is_empty()) {
+            Order& resting_order = price_level.front();
+
+            Quantity fill_quantity =
+              std::min(aggressor.remaining_quantity, resting_order.remaining_quantity);
+            aggressor.remaining_quantity -= fill_quantity;
+            price_level.fill_order(fill_quantity);
+
+            // The executing order is the one this fill completes
+            bool is_resting_executing = resting_order.remaining_quantity == 0;
+            const Order& executing_order =
+              is_resting_executing ? resting_order : aggressor;
+            const Order& reducing_order =
+              is_resting_executing ? aggressor : resting_order;
+            Price price = price_level.get_price();
+            m_last_trade_price = price;
+
+            publish_trade(make_fill_info(executing_order, price, fill_quantity),
+                          make_fill_info(reducing_order, price, fill_quantity));
+            publish_order_event(
+              MarketDataEventType::ORDER_EXECUTED, resting_order, price, fill_quantity);
+
+            if (resting_order.remaining_quantity == 0)
+                price_level.pop_front();
+        }
+
+        if (price_level.is_empty())
+            opposite_ladder.mark_empty(price_level);
+        publish_level_event(price_level);
+    }
+}
+
+CommandResult
+OrderBook::try_add_order(const OrderRequest& order_request)
+{
+    try {
+        bool is_stop = order_request.order_type == OrderType::STOP ||
+                       order_request.order_type == OrderType::STOP_LIMIT;
+        OrderId order_id = is_stop ? add_stop_order(order_request.order_type,
+                                                    order_request.user_id,
+                                                    order_request.side,
+                                                    order_request.get_symbol_name(),
+                                                    order_request.stop_price,
+                                                    order_request.price,
+                                                    order_request.quantity)
+                                   : add_order(order_request.order_type,
+                                               order_request.user_id,
+                                               order_request.side,
+                                               order_request.get_symbol_name(),
+                                               order_request.price,
+                                               order_request.quantity);
+        return CommandResult{ .status = CommandStatus::ACCEPTED, .order_id = order_id };
+    } catch (const std::logic_error&) {
+        return CommandResult{ .status = CommandStatus::REJECTED, .order_id = {} };
     }
+}
+
+CommandResult
+OrderBook::try_modify_order(OrderId order_id, Price new_price, Quantity new_quantity)
+{
+    if (!order_exists(order_id))
+        return CommandResult{ .status = CommandStatus::REJECTED, .order_id = order_id };
+
+    try {
+        modify_order(order_id, new_price, new_quantity);
+        return CommandResult{ .status = CommandStatus::ACCEPTED, .order_id = order_id };
+    } catch (const std::logic_error&) {
+        return CommandResult{ .status = CommandStatus::REJECTED, .order_id = order_id };
+    }
+}
+
+CommandResult
+OrderBook::try_cancel_order(OrderId order_id)
+{
+    if (!order_exists(order_id))
+        return CommandResult{ .status = CommandStatus::REJECTED, .order_id = order_id };
+
+    cancel_order(order_id);
+    return CommandResult{ .status = CommandStatus::ACCEPTED, .order_id = order_id };
+}
+
+/**
+ * @brief Amend a pending stop order. It keeps its place in the trigger index
+ * unless its quantity goes up; only the limit price of a STOP_LIMIT changes,
+ * a STOP stays priced at the edge of the ladder whatever @a new_price is.
+ */
+void
+OrderBook::modify_stop_order(Order& order, Price new_price, Quantity new_quantity)
+{
+    if (order.order_type == OrderType::STOP_LIMIT) {
+        get_price_levels(order.side == 'B' ? LevelType::BID : LevelType::ASK)
+          .at(new_price);
+        order.price = new_price;
+    }
+
+    SeqNum seq_num = order.order_id.seq_num;
+    PriceLevel& stop_level = get_stop_levels(order.side).at(order.stop_price);
+    if (new_quantity <= order.remaining_quantity) {
+        stop_level.modify_order(seq_num, new_quantity);
+        return;
+    }
+
+    Order amended_order = order;
+    amended_order.initial_quantity =
+      order.initial_quantity - order.remaining_quantity + new_quantity;
+    amended_order.remaining_quantity = new_quantity;
+    stop_level.unlink(seq_num);
+    stop_level.push_back(amended_order);
+}
+
+bool
+OrderBook::is_immediate(OrderType order_type)
+{
+    return order_type == OrderType::MARKET || order_type == OrderType::FILL_AND_KILL ||
+           order_type == OrderType::FILL_OR_KILL;
+}
+
+bool
+OrderBook::is_pending_stop(const Order& order)
+{
+    return order.order_type == OrderType::STOP ||
+           order.order_type == OrderType::STOP_LIMIT;
+}
+
+/**
+ * @brief Fill report for one side of a trade. Built on the stack:
+ * no allocation and no I/O on the matching thread.
+ */
+TradeInfo
+OrderBook::make_fill_info(const Order& order, Price price, Quantity fill_quantity)
+{
+    FillType fill_type =
+      order.remaining_quantity == 0 ? FillType::Full : FillType::Partial;
+    return TradeInfo{ .fill_type = fill_type,
+                      .user_id = order.user_id,
+                      .order_id = order.order_id,
+                      .price = price,
+                      .quantity = fill_quantity };
+}
 
-    return pos;
+void
+OrderBook::publish_trade(const TradeInfo& executing_order,
+                         const TradeInfo& reducing_order)
+{
+    if (m_trade_listener != nullptr)
+        m_trade_listener->on_trade(
+          Trade{ .executing_order = executing_order, .reducing_order = reducing_order });
 }
 
-}
\ No newline at end of file
+void
+OrderBook::publish_order_event(MarketDataEventType event_type,
+                               const Order& order,
+                               Price price,
+                               Quantity quantity)
+{
+    if (m_market_data_queue == nullptr)
+        return;
+
+    MarketDataEvent event{ .seq_num = ++m_event_seq_num,
+                           .event_type = event_type,
+                           .side = order.side,
+                           .order_id = order.order_id,
+                           .price = price,
+                           .quantity = quantity,
+                           .order_count = 0 };
+    if (!m_market_data_queue->try_push(event))
+        ++m_dropped_event_count;
+}
+
+void
+OrderBook::publish_level_event(const PriceLevel& price_level)
+{
+    if (m_market_data_queue == nullptr)
+        return;
+
+    Side side = price_level.get_level_type() == LevelType::BID ? 'B' : 'S';
+    MarketDataEvent event{ .seq_num = ++m_event_seq_num,
+                           .event_type = MarketDataEventType::LEVEL_CHANGED,
+                           .side = side,
+                           .order_id = {},
+                           .price = price_level.get_price(),
+                           .quantity = price_level.get_total_quantity(),
+                           .order_count = price_level.get_order_count() };
+    if (!m_market_data_queue->try_push(event))
+        ++m_dropped_event_count;
+}
+
+SeqNum
+OrderBook::get_next_seq_num()
+{
+    return m_order_pool.acquire();
+}
+
+OrderId
+OrderBook::generate_order_id(std::string_view symbol_name)
+{
+    // The symbol is stored zero-padded and is not NUL-terminated when it is
+    // exactly 4 characters long.
+    SeqNum seq_num = get_next_seq_num();
+    OrderId order_id{ .symbol_name = "",
+                      .seq_num = seq_num,
+                      .generation = m_order_pool.get_generation(seq_num) };
+    std::memcpy(order_id.symbol_name,
+                symbol_name.data(),
+                std::min(symbol_name.size(), sizeof(order_id.symbol_name)));
+    return order_id;
+}
+}
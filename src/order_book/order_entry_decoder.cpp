@@ -0,0 +1,312 @@
+#include "order_entry_decoder.h"
+#include "journal.h"
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <system_error>
+#include <unistd.h>
+
+namespace dev {
+OrderEntryDecoder::OrderEntryDecoder(MarketDataManager& market_data_manager)
+  : m_market_data_manager{ market_data_manager }
+  , m_message_count{ 0u }
+  , m_reject_count{ 0u }
+  , m_last_order_id{}
+  , m_expired_count{ 0u }
+  , m_journal{ nullptr }
+{
+}
+
+// Getters
+uint64_t
+OrderEntryDecoder::get_message_count() const
+{
+    return m_message_count;
+}
+
+/**
+ * @brief Number of well-formed messages whose request the manager rejected.
+ */
+uint64_t
+OrderEntryDecoder::get_reject_count() const
+{
+    return m_reject_count;
+}
+
+OrderId
+OrderEntryDecoder::get_last_order_id() const
+{
+    return m_last_order_id;
+}
+
+// Modifiers
+/**
+ * @brief Append every message received from now on to @a journal, or stop
+ * journaling if it is nullptr.
+ */
+void
+OrderEntryDecoder::set_journal(Journal* journal)
+{
+    m_journal = journal;
+}
+
+/**
+ * @brief Apply every complete message at the front of @a bytes, which must be
+ * 8-byte aligned. Returns the number of bytes consumed; the rest is the start
+ * of a message still to be received.
+ */
+std::size_t
+OrderEntryDecoder::decode(std::span<const std::byte> bytes)
+{
+    if (reinterpret_cast<std::uintptr_t>(bytes.data()) % message_alignment != 0)
+        throw std::logic_error("Order entry messages must be read from aligned memory");
+
+    std::size_t position{ 0 };
+    while (bytes.size() - position >= sizeof(MessageHeader)) {
+        const auto& header = *reinterpret_cast<const MessageHeader*>(&bytes[position]);
+        if (bytes.size() - position < header.length) {
+            // Checked before waiting for the rest of the message
+            if (header.length > max_message_size)
+                throw std::logic_error(
+                  std::format("Order entry message of {} bytes", header.length));
+            break;
+        }
+
+        apply(header);
+        position += header.length;
+        ++m_message_count;
+    }
+    return position;
+}
+
+/**
+ * @brief Expire the orders due at or before @a now through an EXPIRE_ORDERS
+ * message, journaled like a received one. Returns the number of orders
+ * cancelled.
+ */
+std::size_t
+OrderEntryDecoder::expire_orders(Timestamp now, std::size_t max_orders)
+{
+    const ExpireOrdersMessage message{ .header = make_header<ExpireOrdersMessage>(),
+                                       .reserved = 0,
+                                       .now = now,
+                                       .max_orders = max_orders };
+    decode(std::as_bytes(std::span(&message, 1)));
+    return m_expired_count;
+}
+
+// Helpers
+/**
+ * @brief Dispatch the message starting with @a header on its type, after
+ * checking its length against the type. The message is journaled ahead of
+ * being applied, whether its request is then accepted or not: a rejected
+ * request may still have changed the manager, by creating the book of a new
+ * symbol. Returns false if the request was rejected.
+ */
+bool
+OrderEntryDecoder::apply(const MessageHeader& header)
+{
+    auto expect_length = [this, &header](std::size_t length) {
+        if (header.length != length)
+            throw std::logic_error(
+              std::format("Order entry message of type {} has length {}",
+                          static_cast<int>(header.message_type),
+                          header.length));
+        if (m_journal != nullptr)
+            m_journal->append(
+              std::span(reinterpret_cast<const std::byte*>(&header), length));
+    };
+
+    switch (header.message_type) {
+        case MessageType::NEW_ORDER:
+            expect_length(sizeof(NewOrderMessage));
+            return on_message(reinterpret_cast<const NewOrderMessage&>(header));
+        case MessageType::CANCEL_ORDER:
+            expect_length(sizeof(CancelOrderMessage));
+            return on_message(reinterpret_cast<const CancelOrderMessage&>(header));
+        case MessageType::MODIFY_ORDER:
+            expect_length(sizeof(ModifyOrderMessage));
+            return on_message(reinterpret_cast<const ModifyOrderMessage&>(header));
+        case MessageType::MASS_CANCEL:
+            expect_length(sizeof(MassCancelMessage));
+            return on_message(reinterpret_cast<const MassCancelMessage&>(header));
+        case MessageType::EXPIRE_ORDERS:
+            expect_length(sizeof(ExpireOrdersMessage));
+            return on_message(reinterpret_cast<const ExpireOrdersMessage&>(header));
+        default:
+            throw std::logic_error(std::format("Unknown order entry message type {}",
+                                               static_cast<int>(header.message_type)));
+    }
+}
+
+/**
+ * @brief Wire fields are checked before they reach the book: an order type in
+ * range, a side of 'B' or 'S', a non-zero quantity and a user interned in the
+ * manager's registry, whose name the trade log will look up.
+ */
+bool
+OrderEntryDecoder::on_message(const NewOrderMessage& message)
+{
+    const OrderRequest& order_request = message.order_request;
+    if (order_request.order_type > OrderType::GOOD_FOR_DAY ||
+        (order_request.side != 'B' && order_request.side != 'S') ||
+        order_request.quantity == 0 ||
+        order_request.user_id >= m_market_data_manager.get_user_registry().size()) {
+        m_last_order_id = OrderId{};
+        ++m_reject_count;
+        return false;
+    }
+
+    try {
+        bool is_stop = order_request.order_type == OrderType::STOP ||
+                       order_request.order_type == OrderType::STOP_LIMIT;
+        m_last_order_id =
+          is_stop ? m_market_data_manager.add_stop_order(order_request.order_type,
+                                                         order_request.user_id,
+                                                         order_request.side,
+                                                         order_request.get_symbol_name(),
+                                                         order_request.stop_price,
+                                                         order_request.price,
+                                                         order_request.quantity)
+                  : m_market_data_manager.add_order(order_request.order_type,
+                                                    order_request.user_id,
+                                                    order_request.side,
+                                                    order_request.get_symbol_name(),
+                                                    order_request.price,
+                                                    order_request.quantity);
+    } catch (const std::logic_error&) {
+        m_last_order_id = OrderId{};
+        ++m_reject_count;
+        return false;
+    }
+    return true;
+}
+
+bool
+OrderEntryDecoder::on_message(const CancelOrderMessage& message)
+{
+    try {
+        m_market_data_manager.cancel_order(message.order_id);
+    } catch (const std::logic_error&) {
+        ++m_reject_count;
+        return false;
+    }
+    return true;
+}
+
+bool
+OrderEntryDecoder::on_message(const ModifyOrderMessage& message)
+{
+    try {
+        m_market_data_manager.modify_order(
+          message.order_id, message.new_price, message.new_quantity);
+    } catch (const std::logic_error&) {
+        ++m_reject_count;
+        return false;
+    }
+    return true;
+}
+
+bool
+OrderEntryDecoder::on_message(const MassCancelMessage& message)
+{
+    std::size_t symbol_length = strnlen(message.symbol_name, sizeof(message.symbol_name));
+    std::optional<Side> side;
+    if (message.side != 0)
+        side = message.side;
+
+    try {
+        m_market_data_manager.mass_cancel(
+          std::string_view{ message.symbol_name, symbol_length }, message.user_id, side);
+    } catch (const std::logic_error&) {
+        ++m_reject_count;
+        return false;
+    }
+    return true;
+}
+
+bool
+OrderEntryDecoder::on_message(const ExpireOrdersMessage& message)
+{
+    m_expired_count = m_market_data_manager.expire_orders(
+      message.now, static_cast<std::size_t>(message.max_orders));
+    return true;
+}
+
+FdIngestor::FdIngestor(int fd, OrderEntryDecoder& decoder, std::size_t buffer_size)
+  : m_fd{ fd }
+  , m_decoder{ decoder }
+  , m_buffer_size{ buffer_size }
+  , m_buffer{}
+  , m_pending_size{ 0u }
+  , m_read_count{ 0u }
+  , m_byte_count{ 0u }
+{
+    if (buffer_size < max_message_size)
+        throw std::logic_error(std::format(
+          "The receive buffer must hold at least {} bytes", max_message_size));
+
+    // operator new aligns the buffer for any scalar type, messages included
+    m_buffer = std::make_unique<std::byte[]>(buffer_size);
+}
+
+// Getters
+uint64_t
+FdIngestor::get_read_count() const
+{
+    return m_read_count;
+}
+
+uint64_t
+FdIngestor::get_byte_count() const
+{
+    return m_byte_count;
+}
+
+// Modifiers
+/**
+ * @brief Read once from the file descriptor, blocking if it is, and apply the
+ * complete messages received. Returns false at end of stream.
+ */
+bool
+FdIngestor::poll_once()
+{
+    ssize_t num_read{ 0 };
+    do {
+        num_read =
+          ::read(m_fd, m_buffer.get() + m_pending_size, m_buffer_size - m_pending_size);
+    } while (num_read < 0 && errno == EINTR);
+
+    if (num_read < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return true;
+        throw std::system_error(errno, std::generic_category(), "Order entry read");
+    }
+    if (num_read == 0)
+        return false;
+
+    ++m_read_count;
+    m_byte_count += static_cast<uint64_t>(num_read);
+
+    std::size_t num_bytes = m_pending_size + static_cast<std::size_t>(num_read);
+    std::size_t num_decoded =
+      m_decoder.decode(std::span<const std::byte>(m_buffer.get(), num_bytes));
+
+    // Keep the partial message for the next read
+    m_pending_size = num_bytes - num_decoded;
+    if (m_pending_size != 0 && num_decoded != 0)
+        std::memmove(m_buffer.get(), m_buffer.get() + num_decoded, m_pending_size);
+    return true;
+}
+
+/**
+ * @brief Ingest until the peer closes the stream.
+ */
+void
+FdIngestor::run()
+{
+    while (poll_once()) {
+    }
+}
+}
@@ -0,0 +1,189 @@
+#include "order_pool.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace dev {
+OrderPool::OrderPool(std::size_t capacity)
+  : m_segments{}
+  , m_size{ 0u }
+  , m_free_head{ 0u }
+  , m_live_count{ 0u }
+{
+    // Pre-fault enough segments for the requested capacity plus the sentinel
+    const std::size_t num_segments = 1 + (capacity / segment_size);
+    m_segments.reserve(num_segments);
+    for (std::size_t i{ 0 }; i < num_segments; ++i)
+        add_segment();
+
+    // Sentinel node at index 0
+    m_segments[0][0] = OrderNode{ .order = {}, .prev = 0u, .next = 0u };
+    m_size = 1;
+}
+
+// Getters
+OrderNode&
+OrderPool::operator[](SeqNum seq_num)
+{
+    return m_segments[seq_num >> segment_shift][seq_num & segment_mask];
+}
+
+const OrderNode&
+OrderPool::operator[](SeqNum seq_num) const
+{
+    return m_segments[seq_num >> segment_shift][seq_num & segment_mask];
+}
+
+/**
+ * @brief Check in O(1) that @a order_id refers to a slot in use and was issued
+ * for the slot's current generation.
+ */
+bool
+OrderPool::is_live(OrderId order_id) const
+{
+    if (order_id.seq_num == 0 || order_id.seq_num >= m_size)
+        return false;
+
+    const OrderNode& order_node = (*this)[order_id.seq_num];
+    return order_node.prev != free_marker &&
+           order_node.order.order_id.generation == order_id.generation;
+}
+
+uint32_t
+OrderPool::get_generation(SeqNum seq_num) const
+{
+    return (*this)[seq_num].order.order_id.generation;
+}
+
+/**
+ * @brief Number of slots created so far, including the sentinel.
+ */
+std::size_t
+OrderPool::size() const
+{
+    return m_size;
+}
+
+/**
+ * @brief Number of slots backed by allocated segments.
+ */
+std::size_t
+OrderPool::capacity() const
+{
+    return m_segments.size() * segment_size;
+}
+
+std::size_t
+OrderPool::get_live_count() const
+{
+    return m_live_count;
+}
+
+// Modifiers
+/**
+ * @brief Take a slot off the free list, or create one if the free list is
+ * empty. The slot keeps its generation and stays marked free, so that ids
+ * issued for it are not live until a price level links the order into it:
+ * until then the slot still holds its previous occupant.
+ */
+SeqNum
+OrderPool::acquire()
+{
+    SeqNum seq_num{};
+    if (m_free_head != 0) {
+        seq_num = m_free_head;
+        m_free_head = (*this)[seq_num].next;
+    } else {
+        if (m_size == free_marker)
+            throw std::logic_error("Order pool is full!");
+
+        if (m_size == capacity())
+            add_segment();
+
+        seq_num = static_cast<SeqNum>(m_size++);
+    }
+
+    OrderNode& order_node = (*this)[seq_num];
+    order_node.prev = free_marker;
+    order_node.next = 0u;
+    ++m_live_count;
+    return seq_num;
+}
+
+/**
+ * @brief Return a slot to the free list and bump its generation, which
+ * invalidates every OrderId issued for it.
+ */
+void
+OrderPool::release(SeqNum seq_num)
+{
+    OrderNode& order_node = (*this)[seq_num];
+    ++order_node.order.order_id.generation;
+    order_node.prev = free_marker;
+    order_node.next = m_free_head;
+    m_free_head = seq_num;
+    --m_live_count;
+}
+
+// Snapshots
+/**
+ * @brief Write the counters, the free list head and every slot created so
+ * far, free ones included, one segment at a time.
+ */
+void
+OrderPool::save_snapshot(SnapshotWriter& writer) const
+{
+    writer.write(uint64_t{ m_size });
+    writer.write(uint64_t{ m_live_count });
+    writer.write(m_free_head);
+    for (std::size_t first{ 0 }; first < m_size; first += segment_size) {
+        std::size_t num_nodes = std::min(segment_size, m_size - first);
+        writer.write_array(std::span<const OrderNode>(
+          m_segments[first >> segment_shift].get(), num_nodes));
+    }
+}
+
+/**
+ * @brief Restore the slots written by @a save_snapshot with one copy per
+ * segment. The free list and the links between nodes come back as they were,
+ * slot numbers and generations included. The pool must be unused.
+ */
+void
+OrderPool::load_snapshot(SnapshotReader& reader)
+{
+    if (m_size != 1 || m_live_count != 0)
+        throw std::logic_error("A snapshot can only be loaded into an unused order pool");
+
+    auto size = static_cast<std::size_t>(reader.read<uint64_t>());
+    auto live_count = static_cast<std::size_t>(reader.read<uint64_t>());
+    auto free_head = reader.read<SeqNum>();
+    if (size == 0 || size > std::size_t{ free_marker } || free_head >= size)
+        throw std::logic_error("The snapshot holds a corrupt order pool");
+
+    while (capacity() < size)
+        add_segment();
+
+    for (std::size_t first{ 0 }; first < size; first += segment_size) {
+        std::size_t num_nodes = std::min(segment_size, size - first);
+        reader.read_array(
+          std::span<OrderNode>(m_segments[first >> segment_shift].get(), num_nodes));
+    }
+
+    m_size = size;
+    m_live_count = live_count;
+    m_free_head = free_head;
+}
+
+/**
+ * @brief Allocate one more segment and write to all of it, so that its pages
+ * are faulted in now rather than on the matching path.
+ */
+void
+OrderPool::add_segment()
+{
+    auto segment = std::make_unique_for_overwrite<OrderNode[]>(segment_size);
+    std::memset(segment.get(), 0, segment_size * sizeof(OrderNode));
+    m_segments.push_back(std::move(segment));
+}
+}
@@ -0,0 +1,413 @@
+#include "price_ladder.h"
+#include "order_book.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <stdexcept>
+
+namespace dev {
+namespace {
+/**
+ * @brief One occupied level of a ladder as saved in a snapshot.
+ */
+struct LevelRecord
+{
+    uint64_t index;
+    SeqNum first_seq_num;
+    SeqNum last_seq_num;
+    Quantity total_quantity;
+    uint64_t order_count;
+};
+
+/**
+ * @brief The tick grid of a ladder, checked on load.
+ */
+struct LadderRecord
+{
+    Price base_price;
+    Price tick_size;
+    uint64_t num_levels;
+    uint64_t num_occupied;
+    uint64_t best_index;
+};
+}
+
+/**
+ * @brief A ladder over the tick grid of @a config. Unless @a is_lazy, every
+ * level is allocated here, off the order path.
+ */
+PriceLadder::PriceLadder(LevelType level_type,
+                         const OrderBookConfig& config,
+                         OrderBook& order_book,
+                         bool is_lazy)
+  : m_level_type{ level_type }
+  , m_base_price{ config.base_price }
+  , m_tick_size{ config.tick_size }
+  , m_num_levels{ config.num_ticks }
+  , m_order_book{ order_book }
+  , m_blocks{}
+  , m_occupancy{}
+  , m_summary{}
+  , m_best_index{ npos }
+  , m_num_occupied{ 0u }
+{
+    if (config.num_ticks == 0 || config.tick_size == 0)
+        throw std::logic_error("A price ladder needs at least one tick of non-zero size");
+
+    const std::size_t num_words = 1 + ((config.num_ticks - 1) / 64);
+    m_blocks.resize(num_words);
+    m_occupancy.assign(num_words, 0u);
+    m_summary.assign(1 + ((num_words - 1) / 64), 0u);
+
+    if (!is_lazy) {
+        for (std::size_t index{ 0 }; index < m_num_levels; index += block_size)
+            allocate_level(index);
+    }
+}
+
+// Getters
+LevelType
+PriceLadder::get_level_type() const
+{
+    return m_level_type;
+}
+
+Price
+PriceLadder::get_min_price() const
+{
+    return m_base_price;
+}
+
+Price
+PriceLadder::get_max_price() const
+{
+    return m_base_price + (m_num_levels - 1) * m_tick_size;
+}
+
+bool
+PriceLadder::is_valid_price(Price price) const
+{
+    if (price < m_base_price)
+        return false;
+
+    Price offset = price - m_base_price;
+    return offset % m_tick_size == 0 && offset / m_tick_size < m_num_levels;
+}
+
+bool
+PriceLadder::empty() const
+{
+    return m_num_occupied == 0;
+}
+
+/**
+ * @brief Number of price levels with open orders.
+ */
+std::size_t
+PriceLadder::size() const
+{
+    return m_num_occupied;
+}
+
+/**
+ * @brief Get the (possibly empty) price level for the user-supplied @a price
+ * in constant-time, allocating its block in a lazy ladder. Throws if the price
+ * is not on the tick grid.
+ */
+PriceLevel&
+PriceLadder::at(Price price)
+{
+    if (!is_valid_price(price))
+        throw std::logic_error(
+          std::format("Price {} is not on the tick grid of the order book", price));
+
+    return allocate_level(to_index(price));
+}
+
+/**
+ * @brief Get the price level for the user-supplied @a price if it has open
+ * orders, nullptr otherwise.
+ */
+PriceLevel*
+PriceLadder::find(Price price)
+{
+    if (!is_valid_price(price))
+        return nullptr;
+
+    std::size_t index = to_index(price);
+    if ((m_occupancy[index >> 6] & (uint64_t{ 1 } << (index & 63))) == 0)
+        return nullptr;
+
+    return &level(index);
+}
+
+/**
+ * @brief Get the best price level in constant-time.
+ */
+PriceLevel&
+PriceLadder::best()
+{
+    if (empty())
+        throw std::logic_error("Price ladder is empty!");
+
+    return level(m_best_index);
+}
+
+const PriceLevel&
+PriceLadder::best() const
+{
+    if (empty())
+        throw std::logic_error("Price ladder is empty!");
+
+    return level(m_best_index);
+}
+
+/**
+ * @brief Get the next occupied price level behind @a price_level in priority
+ * order, or nullptr if there is none.
+ */
+PriceLevel*
+PriceLadder::next_level(const PriceLevel& price_level)
+{
+    std::size_t index = find_next_worse(to_index(price_level));
+    return index == npos ? nullptr : &level(index);
+}
+
+// Modifiers
+/**
+ * @brief Flag @a price_level as having open orders.
+ */
+void
+PriceLadder::mark_occupied(const PriceLevel& price_level)
+{
+    std::size_t index = to_index(price_level);
+    std::size_t word = index >> 6;
+    uint64_t bit = uint64_t{ 1 } << (index & 63);
+
+    if (m_occupancy[word] & bit)
+        return;
+
+    m_occupancy[word] |= bit;
+    m_summary[word >> 6] |= uint64_t{ 1 } << (word & 63);
+    ++m_num_occupied;
+
+    if (m_best_index == npos || is_better(index, m_best_index))
+        m_best_index = index;
+}
+
+/**
+ * @brief Flag @a price_level as empty. If it was the best level, the next
+ * occupied level becomes the best.
+ */
+void
+PriceLadder::mark_empty(const PriceLevel& price_level)
+{
+    std::size_t index = to_index(price_level);
+    std::size_t word = index >> 6;
+    uint64_t bit = uint64_t{ 1 } << (index & 63);
+
+    if ((m_occupancy[word] & bit) == 0)
+        return;
+
+    m_occupancy[word] &= ~bit;
+    if (m_occupancy[word] == 0)
+        m_summary[word >> 6] &= ~(uint64_t{ 1 } << (word & 63));
+    --m_num_occupied;
+
+    if (index == m_best_index)
+        m_best_index = find_next_worse(index);
+}
+
+// Helpers
+/**
+ * @brief The level at @a index, whose block must be allocated: it is occupied,
+ * or was returned by @a at before.
+ */
+PriceLevel&
+PriceLadder::level(std::size_t index)
+{
+    return m_blocks[index / block_size][index % block_size];
+}
+
+const PriceLevel&
+PriceLadder::level(std::size_t index) const
+{
+    return m_blocks[index / block_size][index % block_size];
+}
+
+/**
+ * @brief The level at @a index, allocating its block first if needed.
+ */
+PriceLevel&
+PriceLadder::allocate_level(std::size_t index)
+{
+    std::vector<PriceLevel>& block = m_blocks[index / block_size];
+    if (block.empty()) {
+        std::size_t first_index = index / block_size * block_size;
+        std::size_t num_levels = std::min(block_size, m_num_levels - first_index);
+        block.reserve(num_levels);
+        for (std::size_t i{ first_index }; i < first_index + num_levels; ++i) {
+            Price price = m_base_price + i * m_tick_size;
+            block.emplace_back(m_level_type, price, m_order_book);
+        }
+    }
+    return block[index % block_size];
+}
+
+std::size_t
+PriceLadder::to_index(Price price) const
+{
+    return (price - m_base_price) / m_tick_size;
+}
+
+std::size_t
+PriceLadder::to_index(const PriceLevel& price_level) const
+{
+    return to_index(price_level.get_price());
+}
+
+/**
+ * @brief Bids are better when higher, asks are better when lower.
+ */
+bool
+PriceLadder::is_better(std::size_t lhs, std::size_t rhs) const
+{
+    return m_level_type == LevelType::BID ? lhs > rhs : lhs < rhs;
+}
+
+/**
+ * @brief Index of the lowest occupied level at or above @a from, or npos.
+ */
+std::size_t
+PriceLadder::find_next(std::size_t from) const
+{
+    if (from >= m_num_levels)
+        return npos;
+
+    std::size_t word = from >> 6;
+    uint64_t bits = m_occupancy[word] & (~uint64_t{ 0 } << (from & 63));
+    if (bits != 0)
+        return (word << 6) + std::countr_zero(bits);
+
+    // Use the summary bitmap to skip over empty occupancy words
+    std::size_t next_word = word + 1;
+    std::size_t summary_word = next_word >> 6;
+    if (summary_word >= m_summary.size())
+        return npos;
+
+    uint64_t summary_bits =
+      m_summary[summary_word] & (~uint64_t{ 0 } << (next_word & 63));
+    while (summary_bits == 0) {
+        if (++summary_word == m_summary.size())
+            return npos;
+        summary_bits = m_summary[summary_word];
+    }
+
+    word = (summary_word << 6) + std::countr_zero(summary_bits);
+    return (word << 6) + std::countr_zero(m_occupancy[word]);
+}
+
+/**
+ * @brief Index of the highest occupied level at or below @a from, or npos.
+ */
+std::size_t
+PriceLadder::find_prev(std::size_t from) const
+{
+    from = std::min(from, m_num_levels - 1);
+
+    std::size_t word = from >> 6;
+    uint64_t bits = m_occupancy[word] & (~uint64_t{ 0 } >> (63 - (from & 63)));
+    if (bits != 0)
+        return (word << 6) + 63 - std::countl_zero(bits);
+
+    if (word == 0)
+        return npos;
+
+    // Use the summary bitmap to skip over empty occupancy words
+    std::size_t prev_word = word - 1;
+    std::size_t summary_word = prev_word >> 6;
+    uint64_t summary_bits =
+      m_summary[summary_word] & (~uint64_t{ 0 } >> (63 - (prev_word & 63)));
+    while (summary_bits == 0) {
+        if (summary_word == 0)
+            return npos;
+        summary_bits = m_summary[--summary_word];
+    }
+
+    word = (summary_word << 6) + 63 - std::countl_zero(summary_bits);
+    return (word << 6) + 63 - std::countl_zero(m_occupancy[word]);
+}
+
+/**
+ * @brief Index of the first occupied level behind @a index in priority order.
+ */
+std::size_t
+PriceLadder::find_next_worse(std::size_t index) const
+{
+    if (m_level_type == LevelType::BID)
+        return index == 0 ? npos : find_prev(index - 1);
+
+    return find_next(index + 1);
+}
+
+// Snapshots
+/**
+ * @brief Write the tick grid, the occupancy bitmaps as they are and one
+ * record per occupied level.
+ */
+void
+PriceLadder::save_snapshot(SnapshotWriter& writer) const
+{
+    writer.write(LadderRecord{ .base_price = m_base_price,
+                               .tick_size = m_tick_size,
+                               .num_levels = m_num_levels,
+                               .num_occupied = m_num_occupied,
+                               .best_index = m_best_index });
+    writer.write_array(std::span<const uint64_t>(m_occupancy));
+    writer.write_array(std::span<const uint64_t>(m_summary));
+
+    for (std::size_t word{ 0 }; word < m_occupancy.size(); ++word) {
+        for (uint64_t bits = m_occupancy[word]; bits != 0; bits &= bits - 1) {
+            std::size_t index = (word << 6) + std::countr_zero(bits);
+            const PriceLevel& price_level = level(index);
+            writer.write(LevelRecord{ .index = index,
+                                      .first_seq_num = price_level.get_first_seq_num(),
+                                      .last_seq_num = price_level.get_last_seq_num(),
+                                      .total_quantity = price_level.get_total_quantity(),
+                                      .order_count = price_level.get_order_count() });
+        }
+    }
+}
+
+/**
+ * @brief Restore a ladder saved with the same tick grid into this empty one.
+ */
+void
+PriceLadder::load_snapshot(SnapshotReader& reader)
+{
+    auto ladder_record = reader.read<LadderRecord>();
+    if (ladder_record.base_price != m_base_price ||
+        ladder_record.tick_size != m_tick_size ||
+        ladder_record.num_levels != m_num_levels)
+        throw std::logic_error("The snapshot was taken with another tick grid");
+    if (!empty())
+        throw std::logic_error("A snapshot can only be loaded into an empty ladder");
+
+    reader.read_array(std::span<uint64_t>(m_occupancy));
+    reader.read_array(std::span<uint64_t>(m_summary));
+    for (uint64_t i{ 0 }; i < ladder_record.num_occupied; ++i) {
+        auto level_record = reader.read<LevelRecord>();
+        if (level_record.index >= m_num_levels)
+            throw std::logic_error("A snapshot level is off the tick grid");
+        allocate_level(level_record.index)
+          .restore(level_record.first_seq_num,
+                   level_record.last_seq_num,
+                   level_record.total_quantity,
+                   level_record.order_count);
+    }
+
+    m_num_occupied = ladder_record.num_occupied;
+    m_best_index = ladder_record.best_index;
+}
+}
@@ -3,13 +3,14 @@
 #include "order_node.h"
 
 namespace dev {
-using OrderPool = std::vector<OrderNode>;
 
 PriceLevel::PriceLevel(LevelType type, Price price, OrderBook& order_book)
   : m_level_type{ type }
   , m_price{ price }
   , m_first_seq_num{ 0u }
   , m_last_seq_num{ 0u }
+  , m_total_quantity{ 0u }
+  , m_order_count{ 0u }
   , m_order_book{ order_book }
 {
 }
@@ -20,12 +21,16 @@ PriceLevel::swap(PriceLevel& other)
     std::swap(m_price, other.m_price);
     std::swap(m_first_seq_num, other.m_first_seq_num);
     std::swap(m_last_seq_num, other.m_last_seq_num);
+    std::swap(m_total_quantity, other.m_total_quantity);
+    std::swap(m_order_count, other.m_order_count);
 }
 PriceLevel::PriceLevel(PriceLevel&& other)
   : m_level_type{ std::exchange(other.m_level_type, LevelType::BID) }
   , m_price{ std::exchange(other.m_price, 0u) }
   , m_first_seq_num{ std::exchange(other.m_first_seq_num, 0u) }
   , m_last_seq_num{ std::exchange(other.m_last_seq_num, 0u) }
+  , m_total_quantity{ std::exchange(other.m_total_quantity, 0u) }
+  , m_order_count{ std::exchange(other.m_order_count, 0u) }
   , m_order_book{ other.m_order_book }
 {
 }
@@ -48,25 +53,43 @@ PriceLevel::get_price() const
     return m_price;
 }
 SeqNum
-PriceLevel::get_first_seq_num()
+PriceLevel::get_first_seq_num() const
 {
     return m_first_seq_num;
 }
 SeqNum
-PriceLevel::get_last_seq_num()
+PriceLevel::get_last_seq_num() const
 {
     return m_last_seq_num;
 }
 Order&
 PriceLevel::front()
 {
-    return m_order_book.m_order_pool[m_first_seq_num].order.value();
+    return m_order_book.m_order_pool[m_first_seq_num].order;
 }
 
 Order&
 PriceLevel::back()
 {
-    return m_order_book.m_order_pool[m_last_seq_num].order.value();
+    return m_order_book.m_order_pool[m_last_seq_num].order;
+}
+
+/**
+ * @brief Total open quantity of the orders queued at this level.
+ */
+Quantity
+PriceLevel::get_total_quantity() const
+{
+    return m_total_quantity;
+}
+
+/**
+ * @brief Number of orders queued at this level.
+ */
+std::size_t
+PriceLevel::get_order_count() const
+{
+    return m_order_count;
 }
 
 void
@@ -84,6 +107,9 @@ PriceLevel::on_empty_helper(Order order)
 void
 PriceLevel::push_front(Order order)
 {
+    m_total_quantity += order.remaining_quantity;
+    ++m_order_count;
+
     if (is_empty()) {
         on_empty_helper(order);
         return;
@@ -91,19 +117,11 @@ PriceLevel::push_front(Order order)
     OrderPool& order_pool = m_order_book.m_order_pool;
     OrderNode& front = order_pool[m_first_seq_num];
     SeqNum new_node_seq_num = order.order_id.seq_num;
-    if (new_node_seq_num > order_pool.size()) {
-        order_pool.push_back({
-          .order = order,
-          .prev = 0,
-          .next = m_first_seq_num,
-        });
-    } else {
-        order_pool[new_node_seq_num] = {
-            .order = order,
-            .prev = 0,
-            .next = m_first_seq_num,
-        };
-    }
+    order_pool[new_node_seq_num] = {
+        .order = order,
+        .prev = 0,
+        .next = m_first_seq_num,
+    };
     front.prev = new_node_seq_num;
     m_first_seq_num = new_node_seq_num;
 }
@@ -112,26 +130,29 @@ void
 PriceLevel::pop_front()
 {
     OrderPool& order_pool = m_order_book.m_order_pool;
-    FreeList m_free_list = m_order_book.m_free_list;
-    OrderNode& old_head = order_pool[m_first_seq_num];
+    SeqNum old_head_seq_num = m_first_seq_num;
+    OrderNode& old_head = order_pool[old_head_seq_num];
+    m_total_quantity -= old_head.order.remaining_quantity;
+    --m_order_count;
+
     if (old_head.next == 0) {
-        m_free_list.push_back(m_first_seq_num);
         m_first_seq_num = 0;
         m_last_seq_num = 0;
     } else {
         OrderNode& new_head = order_pool[old_head.next];
-        m_free_list.push_back(m_first_seq_num);
         m_first_seq_num = old_head.next;
+        new_head.prev = 0;
     }
 
-    old_head.order = std::nullopt;
-    old_head.prev = 0;
-    old_head.next = 0;
+    order_pool.release(old_head_seq_num);
 }
 
 void
 PriceLevel::push_back(Order order)
 {
+    m_total_quantity += order.remaining_quantity;
+    ++m_order_count;
+
     if (is_empty()) {
         on_empty_helper(order);
         return;
@@ -139,19 +160,11 @@ PriceLevel::push_back(Order order)
     OrderPool& order_pool = m_order_book.m_order_pool;
     OrderNode& back = order_pool[m_last_seq_num];
     SeqNum new_node_seq_num = order.order_id.seq_num;
-    if (new_node_seq_num > order_pool.size()) {
-        order_pool.push_back({
-          .order = order,
-          .prev = m_last_seq_num,
-          .next = 0,
-        });
-    } else {
-        order_pool[new_node_seq_num] = {
-            .order = order,
-            .prev = m_last_seq_num,
-            .next = 0,
-        };
-    }
+    order_pool[new_node_seq_num] = {
+        .order = order,
+        .prev = m_last_seq_num,
+        .next = 0,
+    };
     back.next = new_node_seq_num;
     m_last_seq_num = new_node_seq_num;
 }
@@ -159,9 +172,11 @@ void
 PriceLevel::pop_back()
 {
     OrderPool& order_pool = m_order_book.m_order_pool;
-    FreeList& free_list = m_order_book.m_free_list;
-    OrderNode& old_tail = order_pool[m_last_seq_num];
-    free_list.push_back(m_last_seq_num);
+    SeqNum old_tail_seq_num = m_last_seq_num;
+    OrderNode& old_tail = order_pool[old_tail_seq_num];
+    m_total_quantity -= old_tail.order.remaining_quantity;
+    --m_order_count;
+
     if (old_tail.prev == 0) {
         m_first_seq_num = 0;
         m_last_seq_num = 0;
@@ -171,25 +186,89 @@ PriceLevel::pop_back()
         new_tail.next = 0;
     }
 
-    old_tail.order = std::nullopt;
-    old_tail.prev = 0;
-    old_tail.next = 0;
+    order_pool.release(old_tail_seq_num);
 }
 
+/**
+ * @brief Unlink the order at @a seq_num from anywhere in the queue
+ * and release its slot to the free list.
+ */
 void
-PriceLevel::fill_order(Order order)
+PriceLevel::erase(SeqNum seq_num)
 {
-    Order& executing_order = front();
-    Order& reducing_order = order;
-    Quantity fill_quantity =
-      std::min(executing_order.remaining_quantity, reducing_order.remaining_quantity);
-    executing_order.remaining_quantity -= fill_quantity;
-    reducing_order.remaining_quantity -= fill_quantity;
-    if (executing_order.remaining_quantity == 0)
-        pop_front();
+    unlink(seq_num);
+    m_order_book.m_order_pool.release(seq_num);
 }
+
+/**
+ * @brief Unlink the order at @a seq_num from anywhere in the queue. The slot
+ * stays allocated to the order, which keeps its id, e.g. to move it to
+ * another level.
+ */
+void
+PriceLevel::unlink(SeqNum seq_num)
+{
+    OrderPool& order_pool = m_order_book.m_order_pool;
+    OrderNode& order_node = order_pool[seq_num];
+    m_total_quantity -= order_node.order.remaining_quantity;
+    --m_order_count;
+
+    if (order_node.prev == 0)
+        m_first_seq_num = order_node.next;
+    else
+        order_pool[order_node.prev].next = order_node.next;
+
+    if (order_node.next == 0)
+        m_last_seq_num = order_node.prev;
+    else
+        order_pool[order_node.next].prev = order_node.prev;
+}
+
+/**
+ * @brief Reduce the open quantity of the order at the front of the queue by
+ * @a fill_quantity. The caller pops the order once it is fully filled, after
+ * reporting the fill.
+ */
+void
+PriceLevel::fill_order(Quantity fill_quantity)
+{
+    front().remaining_quantity -= fill_quantity;
+    m_total_quantity -= fill_quantity;
+}
+
+/**
+ * @brief Replace the open quantity of the order at @a seq_num in place. The
+ * order keeps its position in the queue; the quantity already filled is kept
+ * in its initial quantity.
+ */
+void
+PriceLevel::modify_order(SeqNum seq_num, Quantity new_quantity)
+{
+    Order& order = m_order_book.m_order_pool[seq_num].order;
+    Quantity filled_quantity = order.initial_quantity - order.remaining_quantity;
+    m_total_quantity = m_total_quantity - order.remaining_quantity + new_quantity;
+    order.initial_quantity = filled_quantity + new_quantity;
+    order.remaining_quantity = new_quantity;
+}
+
+/**
+ * @brief Set the queue ends and aggregates of the level as saved in a
+ * snapshot. The nodes themselves are restored with the order pool.
+ */
+void
+PriceLevel::restore(SeqNum first_seq_num,
+                    SeqNum last_seq_num,
+                    Quantity total_quantity,
+                    std::size_t order_count)
+{
+    m_first_seq_num = first_seq_num;
+    m_last_seq_num = last_seq_num;
+    m_total_quantity = total_quantity;
+    m_order_count = order_count;
+}
+
 bool
-PriceLevel::can_fill(Order order)
+PriceLevel::can_fill(const Order& order) const
 {
     bool is_price_cond_met =
       order.side == 'B' ? (m_level_type == LevelType::ASK && m_price <= order.price)
@@ -0,0 +1,266 @@
+#include "sharded_engine.h"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace dev {
+ShardedEngine::Shard::Shard(const OrderBookConfig& config,
+                            std::size_t max_symbols,
+                            UserRegistry& user_registry)
+  : market_data_manager{ config, max_symbols, &user_registry }
+  , commands{}
+  , results{}
+  , worker{}
+{
+}
+
+ShardedEngine::ShardedEngine(std::size_t num_shards,
+                             const OrderBookConfig& config,
+                             std::size_t max_symbols)
+  : m_user_registry{}
+  , m_shards{}
+  , m_symbol_directory{ max_symbols }
+  , m_next_request_id{ 0u }
+  , m_next_poll_shard{ 0u }
+{
+    if (num_shards == 0)
+        throw std::logic_error("A sharded engine needs at least one shard");
+
+    // Symbols are dealt round-robin, shard 0 also takes the ones the
+    // directory cannot hold
+    std::size_t max_symbols_per_shard = max_symbols / num_shards + 1;
+    m_shards.reserve(num_shards);
+    for (std::size_t i{ 0 }; i < num_shards; ++i)
+        m_shards.push_back(
+          std::make_unique<Shard>(config, max_symbols_per_shard, m_user_registry));
+}
+
+ShardedEngine::~ShardedEngine()
+{
+    stop();
+}
+
+// Getters
+std::size_t
+ShardedEngine::get_num_shards() const
+{
+    return m_shards.size();
+}
+
+/**
+ * @brief Get the shard that owns @a symbol_name, if it has been seen.
+ */
+std::optional<std::size_t>
+ShardedEngine::get_shard_index(std::string_view symbol_name) const
+{
+    std::optional<SymbolId> symbol_id = m_symbol_directory.find(symbol_name);
+    if (!symbol_id.has_value())
+        return std::nullopt;
+
+    return *symbol_id % m_shards.size();
+}
+
+/**
+ * @brief Get the books of shard @a shard_index. Only allowed while the engine
+ * is stopped, the shard thread owns them otherwise.
+ */
+MarketDataManager&
+ShardedEngine::get_shard(std::size_t shard_index)
+{
+    if (is_running())
+        throw std::logic_error("Shards cannot be accessed while the engine is running");
+
+    return m_shards.at(shard_index)->market_data_manager;
+}
+
+/**
+ * @brief Get the registry shared by the shards. Names may be interned while
+ * the engine runs, from the ingress thread only.
+ */
+UserRegistry&
+ShardedEngine::get_user_registry()
+{
+    return m_user_registry;
+}
+
+bool
+ShardedEngine::is_running() const
+{
+    return m_shards.front()->worker.joinable();
+}
+
+// Modifiers
+/**
+ * @brief Register the listener notified of every fill on every shard. It is
+ * called concurrently from all shard threads. Only allowed while the engine
+ * is stopped.
+ */
+void
+ShardedEngine::set_trade_listener(TradeListener* trade_listener)
+{
+    if (is_running())
+        throw std::logic_error(
+          "The trade listener cannot be set while the engine is running");
+
+    for (std::unique_ptr<Shard>& shard : m_shards)
+        shard->market_data_manager.set_trade_listener(trade_listener);
+}
+
+/**
+ * @brief Start one matching thread per shard, pinned to CPU `i % num_cpus`
+ * when @a pin_threads is set and the platform supports it.
+ */
+void
+ShardedEngine::start(bool pin_threads)
+{
+    if (is_running())
+        return;
+
+    std::size_t num_cpus = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t i{ 0 }; i < m_shards.size(); ++i) {
+        Shard& shard = *m_shards[i];
+        shard.worker = std::jthread{ [&shard](std::stop_token stop_token) {
+            run(shard, stop_token);
+        } };
+        if (pin_threads)
+            pin_to_cpu(shard.worker, i % num_cpus);
+    }
+}
+
+/**
+ * @brief Stop and join the shard threads. Commands already submitted are
+ * applied first; results that no longer fit into a full result ring are
+ * dropped.
+ */
+void
+ShardedEngine::stop()
+{
+    for (std::unique_ptr<Shard>& shard : m_shards)
+        shard->worker.request_stop();
+
+    for (std::unique_ptr<Shard>& shard : m_shards) {
+        if (shard->worker.joinable())
+            shard->worker.join();
+    }
+}
+
+/**
+ * @brief Route @a command to the shard owning its symbol. Called on the
+ * ingress thread. Returns the id its result will carry, or std::nullopt if the
+ * shard's command ring is full and the command was not accepted.
+ */
+std::optional<uint64_t>
+ShardedEngine::submit(const Command& command)
+{
+    Shard& shard = *m_shards[route(command)];
+    if (!shard.commands.try_push(
+          ShardCommand{ .request_id = m_next_request_id, .command = command }))
+        return std::nullopt;
+
+    return m_next_request_id++;
+}
+
+/**
+ * @brief Move available results into @a results, visiting the shards in turn.
+ * Results of one shard are in submission order. Returns the number written.
+ */
+std::size_t
+ShardedEngine::poll_results(std::span<EngineResult> results)
+{
+    std::size_t num_results{ 0 };
+    for (std::size_t i{ 0 }; i < m_shards.size() && num_results < results.size(); ++i) {
+        Shard& shard = *m_shards[(m_next_poll_shard + i) % m_shards.size()];
+        while (num_results < results.size() &&
+               shard.results.try_pop(results[num_results]))
+            ++num_results;
+    }
+
+    m_next_poll_shard = (m_next_poll_shard + 1) % m_shards.size();
+    return num_results;
+}
+
+// Helpers
+/**
+ * @brief Shard of the symbol of @a command. A symbol is assigned on its first
+ * ADD_ORDER; commands for unknown or malformed symbols go to shard 0, which
+ * rejects them.
+ */
+std::size_t
+ShardedEngine::route(const Command& command)
+{
+    std::string_view symbol_name = command.get_symbol_name();
+    std::optional<SymbolId> symbol_id = m_symbol_directory.find(symbol_name);
+    if (!symbol_id.has_value() && command.command_type == CommandType::ADD_ORDER) {
+        try {
+            symbol_id = m_symbol_directory.intern(symbol_name);
+        } catch (const std::logic_error&) {
+            return 0;
+        }
+    }
+
+    return symbol_id.has_value() ? *symbol_id % m_shards.size() : 0;
+}
+
+/**
+ * @brief Shard thread: apply commands in batches of up to 64 through the batch
+ * API of the shard's manager and publish the results.
+ */
+void
+ShardedEngine::run(Shard& shard, std::stop_token stop_token)
+{
+    constexpr std::size_t batch_capacity = 64;
+    std::array<ShardCommand, batch_capacity> shard_commands;
+    std::array<Command, batch_capacity> commands;
+    std::array<CommandResult, batch_capacity> results;
+
+    while (true) {
+        std::size_t num_commands{ 0 };
+        while (num_commands < batch_capacity &&
+               shard.commands.try_pop(shard_commands[num_commands])) {
+            commands[num_commands] = shard_commands[num_commands].command;
+            ++num_commands;
+        }
+
+        if (num_commands == 0) {
+            if (stop_token.stop_requested())
+                break;
+
+            std::this_thread::yield();
+            continue;
+        }
+
+        shard.market_data_manager.process_commands(
+          std::span(commands).first(num_commands),
+          std::span(results).first(num_commands));
+
+        for (std::size_t i{ 0 }; i < num_commands; ++i) {
+            EngineResult engine_result{ .request_id = shard_commands[i].request_id,
+                                        .result = results[i] };
+            while (!shard.results.try_push(engine_result) && !stop_token.stop_requested())
+                std::this_thread::yield();
+        }
+    }
+}
+
+/**
+ * @brief Best effort: the thread runs unpinned if the CPU is not available.
+ */
+void
+ShardedEngine::pin_to_cpu(std::jthread& worker, std::size_t cpu)
+{
+#if defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    pthread_setaffinity_np(worker.native_handle(), sizeof(cpu_set), &cpu_set);
+#else
+    (void)worker;
+    (void)cpu;
+#endif
+}
+}
@@ -0,0 +1,155 @@
+#include "snapshot.h"
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <format>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace dev {
+SnapshotWriter::SnapshotWriter(const std::string& path)
+  : m_path{ path }
+  , m_temporary_path{ path + ".tmp" }
+  , m_fd{ -1 }
+  , m_buffer{}
+{
+    m_fd = ::open(m_temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0)
+        throw std::system_error(errno,
+                                std::generic_category(),
+                                std::format("Cannot create {}", m_temporary_path));
+
+    m_buffer.reserve(buffer_size);
+}
+
+/**
+ * @brief A snapshot that was not committed is discarded.
+ */
+SnapshotWriter::~SnapshotWriter()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        ::unlink(m_temporary_path.c_str());
+    }
+}
+
+void
+SnapshotWriter::write_bytes(std::span<const std::byte> bytes)
+{
+    if (bytes.size() > buffer_size - m_buffer.size()) {
+        flush_buffer();
+        if (bytes.size() >= buffer_size) {
+            write_fully(bytes);
+            return;
+        }
+    }
+    m_buffer.insert(m_buffer.end(), bytes.begin(), bytes.end());
+}
+
+/**
+ * @brief Write the rest of the image, wait until it is on disk and publish it
+ * under the final path.
+ */
+void
+SnapshotWriter::commit()
+{
+    flush_buffer();
+    if (::fdatasync(m_fd) != 0)
+        throw std::system_error(
+          errno, std::generic_category(), "Cannot sync the snapshot");
+
+    ::close(m_fd);
+    m_fd = -1;
+    if (std::rename(m_temporary_path.c_str(), m_path.c_str()) != 0)
+        throw std::system_error(
+          errno, std::generic_category(), std::format("Cannot publish {}", m_path));
+}
+
+void
+SnapshotWriter::flush_buffer()
+{
+    write_fully(m_buffer);
+    m_buffer.clear();
+}
+
+void
+SnapshotWriter::write_fully(std::span<const std::byte> bytes)
+{
+    while (!bytes.empty()) {
+        ssize_t num_written = ::write(m_fd, bytes.data(), bytes.size());
+        if (num_written < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(
+              errno, std::generic_category(), "Cannot write the snapshot");
+        }
+        bytes = bytes.subspan(static_cast<std::size_t>(num_written));
+    }
+}
+
+SnapshotReader::SnapshotReader(const std::string& path)
+  : m_fd{ -1 }
+  , m_mapping{ nullptr }
+  , m_size{ 0u }
+  , m_position{ 0u }
+{
+    m_fd = ::open(path.c_str(), O_RDONLY);
+    if (m_fd < 0)
+        throw std::system_error(
+          errno, std::generic_category(), std::format("Cannot open {}", path));
+
+    struct stat file_stat{};
+    if (::fstat(m_fd, &file_stat) != 0) {
+        int error = errno;
+        ::close(m_fd);
+        throw std::system_error(
+          error, std::generic_category(), std::format("Cannot stat {}", path));
+    }
+
+    m_size = static_cast<std::size_t>(file_stat.st_size);
+    if (m_size == 0)
+        return;
+
+    void* mapping = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (mapping == MAP_FAILED) {
+        int error = errno;
+        ::close(m_fd);
+        throw std::system_error(
+          error, std::generic_category(), std::format("Cannot map {}", path));
+    }
+
+    m_mapping = static_cast<const std::byte*>(mapping);
+    ::madvise(mapping, m_size, MADV_SEQUENTIAL);
+    ::madvise(mapping, m_size, MADV_WILLNEED);
+}
+
+SnapshotReader::~SnapshotReader()
+{
+    if (m_mapping != nullptr)
+        ::munmap(const_cast<std::byte*>(m_mapping), m_size);
+    ::close(m_fd);
+}
+
+/**
+ * @brief The next @a size bytes of the file, valid as long as the reader.
+ */
+std::span<const std::byte>
+SnapshotReader::read_bytes(std::size_t size)
+{
+    if (size > m_size - m_position)
+        throw std::logic_error("The snapshot is truncated");
+
+    std::span<const std::byte> bytes{ m_mapping + m_position, size };
+    m_position += size;
+    return bytes;
+}
+
+bool
+SnapshotReader::at_end() const
+{
+    return m_position == m_size;
+}
+}
@@ -0,0 +1,123 @@
+#include "symbol_directory.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+namespace dev {
+SymbolDirectory::SymbolDirectory(std::size_t capacity)
+  : m_capacity{ capacity }
+  , m_symbol_names{ std::make_unique<std::array<char, 4>[]>(capacity) }
+  , m_table_bits{ std::max<std::size_t>(1, std::bit_width(2 * capacity)) }
+  , m_table{ std::make_unique<Slot[]>(std::size_t{ 1 } << m_table_bits) }
+  , m_size{ 0u }
+{
+}
+
+// Getters
+std::optional<SymbolId>
+SymbolDirectory::find(std::string_view symbol_name) const
+{
+    return find(to_key(symbol_name));
+}
+
+/**
+ * @brief Resolve a symbol key, see @a to_key, to its id.
+ */
+std::optional<SymbolId>
+SymbolDirectory::find(uint32_t key) const
+{
+    if (key == 0)
+        return std::nullopt;
+
+    std::size_t mask = (std::size_t{ 1 } << m_table_bits) - 1;
+    for (std::size_t slot = to_slot(key);; slot = (slot + 1) & mask) {
+        if (m_table[slot].key == key)
+            return m_table[slot].symbol_id;
+        if (m_table[slot].key == 0)
+            return std::nullopt;
+    }
+}
+
+/**
+ * @brief Resolve an id back to the symbol. Safe to call from a thread other
+ * than the one interning, for any id it has been handed.
+ */
+std::string_view
+SymbolDirectory::get_symbol_name(SymbolId symbol_id) const
+{
+    if (symbol_id >= m_size.load(std::memory_order_acquire))
+        throw std::logic_error(std::format("SymbolId {} is not registered!", symbol_id));
+
+    const std::array<char, 4>& symbol_name = m_symbol_names[symbol_id];
+    return { symbol_name.data(), strnlen(symbol_name.data(), symbol_name.size()) };
+}
+
+std::size_t
+SymbolDirectory::size() const
+{
+    return m_size.load(std::memory_order_acquire);
+}
+
+std::size_t
+SymbolDirectory::capacity() const
+{
+    return m_capacity;
+}
+
+// Modifiers
+/**
+ * @brief Get the id of @a symbol_name, registering it on first use.
+ */
+SymbolId
+SymbolDirectory::intern(std::string_view symbol_name)
+{
+    uint32_t key = to_key(symbol_name);
+    if (key == 0)
+        throw std::logic_error(
+          std::format("Symbol '{}' must be 1 to 4 characters long", symbol_name));
+
+    std::size_t mask = (std::size_t{ 1 } << m_table_bits) - 1;
+    std::size_t slot = to_slot(key);
+    for (; m_table[slot].key != 0; slot = (slot + 1) & mask) {
+        if (m_table[slot].key == key)
+            return m_table[slot].symbol_id;
+    }
+
+    std::size_t size = m_size.load(std::memory_order_relaxed);
+    if (size == m_capacity)
+        throw std::logic_error("Symbol directory is full!");
+
+    std::memcpy(m_symbol_names[size].data(), &key, sizeof(key));
+    SymbolId symbol_id = static_cast<SymbolId>(size);
+    m_table[slot] = Slot{ .key = key, .symbol_id = symbol_id };
+    m_size.store(size + 1, std::memory_order_release);
+    return symbol_id;
+}
+
+/**
+ * @brief The zero-padded characters of @a symbol_name loaded as one integer,
+ * or 0 if it is empty or longer than 4 characters.
+ */
+uint32_t
+SymbolDirectory::to_key(std::string_view symbol_name)
+{
+    uint32_t key{ 0 };
+    if (symbol_name.size() > sizeof(key))
+        return 0;
+
+    std::memcpy(&key, symbol_name.data(), symbol_name.size());
+    return key;
+}
+
+// Helpers
+/**
+ * @brief Fibonacci hashing: the top bits of the key times 2^32 / phi.
+ */
+std::size_t
+SymbolDirectory::to_slot(uint32_t key) const
+{
+    return static_cast<uint32_t>(key * 0x9E3779B1u) >> (32 - m_table_bits);
+}
+}
@@ -0,0 +1,346 @@
+#include "timer_wheel.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace dev {
+TimerWheel::TimerWheel(Timestamp start_time)
+  : m_levels{}
+  , m_occupancy{}
+  , m_overflow{}
+  , m_overflow_min{ std::numeric_limits<Timestamp>::max() }
+  , m_current_tick{ start_time }
+  , m_drain_position{ 0u }
+  , m_is_draining{ false }
+  , m_cascade_level{ 0u }
+  , m_cascade_position{ 0u }
+  , m_overflow_kept{ 0u }
+  , m_overflow_kept_min{ std::numeric_limits<Timestamp>::max() }
+  , m_size{ 0u }
+  , m_work_done{ 0u }
+{
+}
+
+// Getters
+/**
+ * @brief The next tick the wheel will expire. Every entry due before it has
+ * been handed out.
+ */
+Timestamp
+TimerWheel::get_current_time() const
+{
+    return m_current_tick;
+}
+
+/**
+ * @brief Number of scheduled entries not yet handed out, stale ones included.
+ */
+std::size_t
+TimerWheel::size() const
+{
+    return m_size;
+}
+
+bool
+TimerWheel::empty() const
+{
+    return m_size == 0;
+}
+
+/**
+ * @brief Check whether an entry is due at or before @a now.
+ */
+bool
+TimerWheel::has_expired(Timestamp now) const
+{
+    return m_is_draining || m_cascade_level != 0 ||
+           (m_size != 0 && find_next_tick() <= now);
+}
+
+/**
+ * @brief Entries handed out or moved by @a collect_expired so far, the unit
+ * of its budget.
+ */
+uint64_t
+TimerWheel::get_work_done() const
+{
+    return m_work_done;
+}
+
+// Modifiers
+/**
+ * @brief Schedule @a order_id to expire at @a expire_time in O(1). An expiry
+ * in the past is due at the next call to @a collect_expired.
+ */
+void
+TimerWheel::schedule(OrderId order_id, Timestamp expire_time)
+{
+    insert(TimerEntry{ .order_id = order_id, .expire_time = expire_time });
+    ++m_size;
+}
+
+/**
+ * @brief Advance the wheel to @a now and write the orders due at or before it
+ * to @a expired_ids, in expiry order.
+ *
+ * Each entry handed out or moved down a level counts as one unit of work, and
+ * a call does at most `expired_ids.size()` units, resuming where it stopped on
+ * the next call; it may thus return 0 while @a has_expired is still true.
+ * Returns the number of ids written.
+ */
+std::size_t
+TimerWheel::collect_expired(Timestamp now, std::span<OrderId> expired_ids)
+{
+    std::size_t max_work = expired_ids.size();
+    std::size_t work{ 0 };
+    std::size_t num_expired{ 0 };
+    while (work < max_work) {
+        if (m_cascade_level != 0) {
+            work += continue_cascade(max_work - work);
+            continue;
+        }
+
+        if (!m_is_draining) {
+            if (m_size == 0 || m_current_tick > now)
+                break;
+
+            Timestamp next_tick = find_next_tick();
+            if (next_tick > now) {
+                // Nothing is due up to now, not even a cascade
+                m_current_tick = now + 1;
+                break;
+            }
+
+            m_current_tick = next_tick;
+            start_cascade(num_levels + 1);
+            continue;
+        }
+
+        std::size_t slot_index = m_current_tick & (num_slots - 1);
+        Slot& slot = m_levels[0][slot_index];
+        while (work < max_work && m_drain_position < slot.size()) {
+            expired_ids[num_expired++] = slot[m_drain_position++].order_id;
+            ++work;
+        }
+
+        if (m_drain_position == slot.size()) {
+            slot.clear();
+            m_occupancy[0] &= ~(uint64_t{ 1 } << slot_index);
+            m_is_draining = false;
+            ++m_current_tick;
+        }
+    }
+
+    m_size -= num_expired;
+    m_work_done += work;
+    return num_expired;
+}
+
+// Snapshots
+/**
+ * @brief Write the current tick and the entries not yet handed out. Their
+ * position in the wheel only depends on the current tick, so it is not saved.
+ */
+void
+TimerWheel::save_snapshot(SnapshotWriter& writer) const
+{
+    writer.write(m_current_tick);
+    writer.write(uint64_t{ m_size });
+
+    // Entries already handed out or moved by a cascade in progress are skipped
+    for (std::size_t level{ 0 }; level < num_levels; ++level) {
+        std::size_t shift = level * slot_bits;
+        std::size_t current_slot = (m_current_tick >> shift) & (num_slots - 1);
+        for (std::size_t slot_index{ 0 }; slot_index < num_slots; ++slot_index) {
+            std::span<const TimerEntry> entries = m_levels[level][slot_index];
+            if (slot_index == current_slot && level == 0 && m_is_draining)
+                entries = entries.subspan(m_drain_position);
+            if (slot_index == current_slot && level != 0 && level == m_cascade_level)
+                entries = entries.subspan(m_cascade_position);
+            writer.write_array(entries);
+        }
+    }
+
+    std::span<const TimerEntry> overflow = m_overflow;
+    if (m_cascade_level == num_levels) {
+        writer.write_array(overflow.first(m_overflow_kept));
+        overflow = overflow.subspan(m_cascade_position);
+    }
+    writer.write_array(overflow);
+}
+
+/**
+ * @brief Reschedule the entries of a snapshot into this empty wheel.
+ */
+void
+TimerWheel::load_snapshot(SnapshotReader& reader)
+{
+    if (!empty())
+        throw std::logic_error("A snapshot can only be loaded into an empty timer wheel");
+
+    m_current_tick = reader.read<Timestamp>();
+    auto size = static_cast<std::size_t>(reader.read<uint64_t>());
+    for (std::size_t i{ 0 }; i < size; ++i) {
+        auto entry = reader.read<TimerEntry>();
+        schedule(entry.order_id, entry.expire_time);
+    }
+}
+
+// Helpers
+/**
+ * @brief The lowest level whose slot separates @a expire_tick from the current
+ * tick: the level of the highest 6-bit group in which they differ.
+ */
+std::size_t
+TimerWheel::level_of(Timestamp expire_tick) const
+{
+    uint64_t diff = expire_tick ^ m_current_tick;
+    return diff == 0 ? 0 : (std::bit_width(diff) - 1) / slot_bits;
+}
+
+void
+TimerWheel::insert(const TimerEntry& entry)
+{
+    Timestamp expire_tick = std::max(entry.expire_time, m_current_tick);
+    std::size_t level = level_of(expire_tick);
+    if (level >= num_levels) {
+        m_overflow.push_back(entry);
+        m_overflow_min = std::min(m_overflow_min, entry.expire_time);
+        return;
+    }
+
+    std::size_t slot_index = (expire_tick >> (level * slot_bits)) & (num_slots - 1);
+    m_levels[level][slot_index].push_back(entry);
+    m_occupancy[level] |= uint64_t{ 1 } << slot_index;
+}
+
+/**
+ * @brief Select the next source to cascade at the current tick, top first:
+ * the overflow list if @a below_level is above the top level and its earliest
+ * period starts here, then the occupied slots starting here on the levels
+ * below @a below_level. Once none is left, level 0 holds everything due at the
+ * current tick and is drained.
+ */
+void
+TimerWheel::start_cascade(std::size_t below_level)
+{
+    constexpr std::size_t overflow_shift = num_levels * slot_bits;
+    m_cascade_position = 0;
+    if (below_level > num_levels && !m_overflow.empty() &&
+        (m_overflow_min >> overflow_shift) == (m_current_tick >> overflow_shift)) {
+        m_cascade_level = num_levels;
+        m_overflow_kept = 0;
+        m_overflow_kept_min = std::numeric_limits<Timestamp>::max();
+        return;
+    }
+
+    for (std::size_t level{ std::min(below_level, num_levels) - 1 }; level > 0; --level) {
+        std::size_t shift = level * slot_bits;
+        std::size_t slot_index = (m_current_tick >> shift) & (num_slots - 1);
+        if ((m_current_tick & ((uint64_t{ 1 } << shift) - 1)) == 0 &&
+            (m_occupancy[level] & (uint64_t{ 1 } << slot_index)) != 0) {
+            m_cascade_level = level;
+            return;
+        }
+    }
+
+    m_cascade_level = 0;
+    m_drain_position = 0;
+    m_is_draining = true;
+}
+
+/**
+ * @brief Move at most @a max_work entries of the cascade in progress and
+ * return how many were moved. Entries of a slot always land on lower levels,
+ * and entries scheduled meanwhile never land in the slot being moved, so the
+ * slot can be read in place.
+ */
+std::size_t
+TimerWheel::continue_cascade(std::size_t max_work)
+{
+    std::size_t work{ 0 };
+    if (m_cascade_level == num_levels) {
+        // Entries of later periods stay in the list, compacted to its front
+        while (work < max_work && m_cascade_position < m_overflow.size()) {
+            TimerEntry entry = m_overflow[m_cascade_position++];
+            if (level_of(std::max(entry.expire_time, m_current_tick)) < num_levels) {
+                insert(entry);
+            } else {
+                m_overflow[m_overflow_kept++] = entry;
+                m_overflow_kept_min = std::min(m_overflow_kept_min, entry.expire_time);
+            }
+            ++work;
+        }
+        if (m_cascade_position == m_overflow.size()) {
+            m_overflow.resize(m_overflow_kept);
+            m_overflow_min = m_overflow_kept_min;
+            start_cascade(num_levels);
+        }
+        return work;
+    }
+
+    std::size_t level = m_cascade_level;
+    std::size_t slot_index = (m_current_tick >> (level * slot_bits)) & (num_slots - 1);
+    Slot& slot = m_levels[level][slot_index];
+    while (work < max_work && m_cascade_position < slot.size()) {
+        insert(slot[m_cascade_position++]);
+        ++work;
+    }
+    if (m_cascade_position == slot.size()) {
+        slot.clear();
+        m_occupancy[level] &= ~(uint64_t{ 1 } << slot_index);
+        start_cascade(level);
+    }
+    return work;
+}
+
+/**
+ * @brief The first tick at or after the current one at which a level 0 slot
+ * is due or a higher level slot must be cascaded, found with one mask scan per
+ * level.
+ */
+Timestamp
+TimerWheel::find_next_tick() const
+{
+    Timestamp next_tick = std::numeric_limits<Timestamp>::max();
+
+    // Level 0 entries are due at or after the current tick
+    constexpr Timestamp slot_mask = num_slots - 1;
+    uint64_t bits = m_occupancy[0] & (~uint64_t{ 0 } << (m_current_tick & slot_mask));
+    if (bits != 0)
+        next_tick = (m_current_tick & ~slot_mask) + std::countr_zero(bits);
+
+    // Higher level entries sit in slots after the current one, or in the
+    // current one if the wheel stands at its start and has not cascaded it yet
+    for (std::size_t level{ 1 }; level < num_levels; ++level) {
+        std::size_t shift = level * slot_bits;
+        bool is_slot_start = (m_current_tick & ((Timestamp{ 1 } << shift) - 1)) == 0;
+        std::size_t first_slot =
+          ((m_current_tick >> shift) & slot_mask) + (is_slot_start ? 0 : 1);
+        if (first_slot == num_slots)
+            continue;
+
+        bits = m_occupancy[level] & (~uint64_t{ 0 } << first_slot);
+        if (bits == 0)
+            continue;
+
+        std::size_t block_shift = shift + slot_bits;
+        Timestamp block_start = (m_current_tick >> block_shift) << block_shift;
+        Timestamp slot_index = std::countr_zero(bits);
+        Timestamp slot_start = block_start + (slot_index << shift);
+        next_tick = std::min(next_tick, slot_start);
+    }
+
+    // The overflow list is cascaded at the start of its earliest period, which
+    // is after the current one
+    if (!m_overflow.empty()) {
+        constexpr std::size_t overflow_shift = num_levels * slot_bits;
+        Timestamp overflow_start = (m_overflow_min >> overflow_shift) << overflow_shift;
+        next_tick = std::min(next_tick, std::max(overflow_start, m_current_tick));
+    }
+    return next_tick;
+}
+}
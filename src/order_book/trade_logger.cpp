@@ -0,0 +1,79 @@
+#include "trade_logger.h"
+#include "formatter.h"
+#include <chrono>
+#include <format>
+
+namespace dev {
+TradeLogger::TradeLogger(std::ostream& os, const UserRegistry* user_registry)
+  : m_os{ os }
+  , m_user_registry{ user_registry }
+  , m_queue{}
+  , m_dropped_count{ 0u }
+  , m_worker{ [this](std::stop_token stop_token) { run(stop_token); } }
+{
+}
+
+TradeLogger::~TradeLogger()
+{
+    m_worker.request_stop();
+    m_worker.join();
+}
+
+/**
+ * @brief Called on the matching thread: a copy into the ring, no formatting.
+ */
+void
+TradeLogger::on_trade(const Trade& trade)
+{
+    if (!m_queue.try_push(trade))
+        m_dropped_count.fetch_add(1u, std::memory_order_relaxed);
+}
+
+uint64_t
+TradeLogger::get_dropped_count() const
+{
+    return m_dropped_count.load(std::memory_order_relaxed);
+}
+
+void
+TradeLogger::run(std::stop_token stop_token)
+{
+    using namespace std::chrono_literals;
+
+    while (!stop_token.stop_requested()) {
+        if (m_queue.empty()) {
+            std::this_thread::sleep_for(50us);
+            continue;
+        }
+        drain();
+    }
+
+    // Flush whatever was published before the stop request
+    drain();
+}
+
+void
+TradeLogger::drain()
+{
+    Trade trade{};
+    while (m_queue.try_pop(trade)) {
+        m_os << std::format("\nexecuting_order_fill_info={} user_name={}",
+                            trade.executing_order,
+                            get_user_name(trade.executing_order.user_id))
+             << std::format("\nreducing_order_fill_info={} user_name={}",
+                            trade.reducing_order,
+                            get_user_name(trade.reducing_order.user_id))
+             << "\n";
+    }
+    m_os.flush();
+}
+
+std::string_view
+TradeLogger::get_user_name(UserId user_id) const
+{
+    if (m_user_registry == nullptr)
+        return "?";
+
+    return m_user_registry->get_user_name(user_id);
+}
+}
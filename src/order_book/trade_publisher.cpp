@@ -0,0 +1,82 @@
+#include "trade_publisher.h"
+#include <array>
+#include <chrono>
+#include <span>
+
+namespace dev {
+TradePublisher::TradePublisher(TradeListener& downstream)
+  : m_downstream{ downstream }
+  , m_queue{}
+  , m_dropped_count{ 0u }
+  , m_published_count{ 0u }
+  , m_worker{ [this](std::stop_token stop_token) { run(stop_token); } }
+{
+}
+
+TradePublisher::~TradePublisher()
+{
+    m_worker.request_stop();
+    m_worker.join();
+}
+
+/**
+ * @brief Called on any matching thread: a copy into the ring, nothing else.
+ */
+void
+TradePublisher::on_trade(const Trade& trade)
+{
+    if (!m_queue.try_push(trade))
+        m_dropped_count.fetch_add(1u, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Approximate number of trades waiting for the publisher thread.
+ */
+std::size_t
+TradePublisher::get_queue_depth() const
+{
+    return m_queue.size();
+}
+
+uint64_t
+TradePublisher::get_dropped_count() const
+{
+    return m_dropped_count.load(std::memory_order_relaxed);
+}
+
+uint64_t
+TradePublisher::get_published_count() const
+{
+    return m_published_count.load(std::memory_order_relaxed);
+}
+
+void
+TradePublisher::run(std::stop_token stop_token)
+{
+    using namespace std::chrono_literals;
+
+    while (!stop_token.stop_requested()) {
+        if (drain() == 0)
+            std::this_thread::sleep_for(50us);
+    }
+
+    // Flush whatever was published before the stop request
+    while (drain() != 0) {
+    }
+}
+
+/**
+ * @brief Forward one batch of trades downstream. Returns the batch size.
+ */
+std::size_t
+TradePublisher::drain()
+{
+    std::array<Trade, batch_capacity> trades;
+    std::size_t num_trades = m_queue.try_pop_batch(trades);
+    for (std::size_t i{ 0 }; i < num_trades; ++i)
+        m_downstream.on_trade(trades[i]);
+
+    m_published_count.fetch_add(num_trades, std::memory_order_relaxed);
+    return num_trades;
+}
+}
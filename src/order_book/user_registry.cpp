@@ -0,0 +1,72 @@
+#include "user_registry.h"
+#include <format>
+#include <stdexcept>
+
+namespace dev {
+UserRegistry::UserRegistry(std::size_t capacity)
+  : m_capacity{ capacity }
+  , m_user_names{ std::make_unique<std::string[]>(capacity) }
+  , m_user_ids{}
+  , m_size{ 0u }
+{
+    m_user_ids.reserve(capacity);
+}
+
+// Getters
+std::optional<UserId>
+UserRegistry::find(std::string_view user_name) const
+{
+    auto it = m_user_ids.find(user_name);
+    if (it == m_user_ids.end())
+        return std::nullopt;
+
+    return it->second;
+}
+
+/**
+ * @brief Resolve a handle back to the user name. Safe to call from a thread
+ * other than the one interning, for any id it has been handed.
+ */
+std::string_view
+UserRegistry::get_user_name(UserId user_id) const
+{
+    if (user_id >= m_size.load(std::memory_order_acquire))
+        throw std::logic_error(std::format("UserId {} is not registered!", user_id));
+
+    return m_user_names[user_id];
+}
+
+std::size_t
+UserRegistry::size() const
+{
+    return m_size.load(std::memory_order_acquire);
+}
+
+std::size_t
+UserRegistry::capacity() const
+{
+    return m_capacity;
+}
+
+// Modifiers
+/**
+ * @brief Get the handle of @a user_name, registering it on first use.
+ */
+UserId
+UserRegistry::intern(std::string_view user_name)
+{
+    auto it = m_user_ids.find(user_name);
+    if (it != m_user_ids.end())
+        return it->second;
+
+    std::size_t size = m_size.load(std::memory_order_relaxed);
+    if (size == m_capacity)
+        throw std::logic_error("User registry is full!");
+
+    m_user_names[size] = user_name;
+    UserId user_id = static_cast<UserId>(size);
+    m_user_ids.emplace(m_user_names[size], user_id);
+    m_size.store(size + 1, std::memory_order_release);
+    return user_id;
+}
+}
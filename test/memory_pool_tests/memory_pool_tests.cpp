@@ -1,7 +1,18 @@
+#include "atomic_bucket.h"
 #include "bucket.h"
+#include "caching_memory_pool.h"
 #include "memory_pool.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <latch>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
 TEST(memory_pool_tests, BasicAllocation)
@@ -57,6 +68,254 @@ TEST(memory_pool_tests, MultipleAllocationsFromSameBucket)
     pool.deallocate(ptr3, 1);
 }
 
+TEST(memory_pool_tests, BucketFindsRunsAcrossLedgerWords)
+{
+    /* First-fit runs within and across 64-bit ledger words */
+    dev::Bucket bucket{ 8, 200 };
+    bucket.set_blocks_in_use(0, 60);
+    bucket.set_blocks_in_use(62, 70);
+
+    // Blocks 60-61 hold a run of 2, the next run of 3 starts at 132
+    ASSERT_EQ(bucket.find_contiguous_blocks(1), 60);
+    ASSERT_EQ(bucket.find_contiguous_blocks(2), 60);
+    ASSERT_EQ(bucket.find_contiguous_blocks(3), 132);
+    ASSERT_EQ(bucket.find_contiguous_blocks(68), 132);
+    ASSERT_EQ(bucket.find_contiguous_blocks(69), 200);
+
+    // Freeing behind the hint cursor is found again
+    bucket.set_blocks_in_use(60, 140);
+    ASSERT_EQ(bucket.find_contiguous_blocks(1), 200);
+    ASSERT_EQ(bucket.allocate(8), nullptr);
+    bucket.set_blocks_free(5, 3);
+    ASSERT_EQ(bucket.find_contiguous_blocks(3), 5);
+    ASSERT_EQ(bucket.find_contiguous_blocks(4), 200);
+}
+
+TEST(memory_pool_tests, BucketOrderTableFollowsWasteThenBlockCount)
+{
+    /* Size-to-bucket dispatch is precomputed from the descriptors */
+    using Pool = dev::MemoryPool<1>;
+    static_assert(Pool::max_block_size == 1024);
+
+    // 4 bytes: an exact block, then exact multi-block fits, then waste
+    constexpr auto order4 = Pool::bucket_order_table[4];
+    ASSERT_EQ(Pool::block_sizes[order4[0]], 4);
+    ASSERT_EQ(Pool::block_sizes[order4[1]], 2);
+    ASSERT_EQ(Pool::block_sizes[order4[2]], 1);
+    ASSERT_EQ(Pool::block_sizes[order4[3]], 8);
+
+    // 100 bytes: 128, 2 x 64 and 4 x 32 all waste 28, fewest blocks first
+    constexpr auto order100 = Pool::bucket_order_table[100];
+    ASSERT_EQ(Pool::block_sizes[order100[3]], 8);
+    ASSERT_EQ(Pool::block_sizes[order100[4]], 16);
+    ASSERT_EQ(Pool::block_sizes[order100[5]], 128);
+    ASSERT_EQ(Pool::block_sizes[order100[6]], 64);
+    ASSERT_EQ(Pool::block_sizes[order100[7]], 32);
+
+    // Past the table the order is computed the same way
+    ASSERT_EQ(Pool::make_bucket_order(2048), Pool::bucket_order_table[1024]);
+}
+
+TEST(memory_pool_tests, DeallocateResolvesOwnerAndSizeFromAddress)
+{
+    /* Owner bucket and allocation size both come from the address */
+    dev::MemoryPool pool;
+    void* ptr1 = pool.allocate(24);
+    void* ptr2 = pool.allocate(8);
+    dev::Bucket* bucket = pool.owner(ptr1);
+    ASSERT_NE(bucket, nullptr);
+    ASSERT_EQ(bucket, pool.owner(ptr2));
+    ASSERT_EQ(bucket->BlockSize, 8);
+    ASSERT_EQ(static_cast<std::byte*>(ptr2) - static_cast<std::byte*>(ptr1), 24);
+
+    // Without a size, and with a wrong one
+    pool.deallocate(ptr1);
+    pool.deallocate(ptr2, 1000);
+    ASSERT_EQ(bucket->find_contiguous_blocks(4), 0);
+
+    int local{0};
+    ASSERT_EQ(pool.owner(&local), nullptr);
+    pool.deallocate(&local);
+
+    // A run spanning ledger words
+    dev::Bucket standalone{ 8, 200 };
+    void* ptr3 = standalone.allocate(8 * 70);
+    void* ptr4 = standalone.allocate(8);
+    standalone.deallocate(ptr3);
+    ASSERT_EQ(standalone.find_contiguous_blocks(70), 0);
+    ASSERT_EQ(standalone.find_contiguous_blocks(71), 71);
+    standalone.deallocate(ptr4);
+    ASSERT_EQ(standalone.find_contiguous_blocks(200), 0);
+}
+
+TEST(memory_pool_tests, CachingPoolRecyclesBlocksFreedByAnotherThread)
+{
+    /* Blocks allocated by one thread and freed by another are reused */
+    using Pool = dev::CachingMemoryPool<1>;
+    ASSERT_EQ(Pool::pool_t::block_sizes[Pool::size_class(24)], 32);
+    ASSERT_EQ(Pool::pool_t::block_sizes[Pool::size_class(1)], 8);
+    ASSERT_EQ(Pool::size_class(2048), Pool::no_size_class);
+
+    constexpr std::size_t num_blocks = 100'000;
+    constexpr std::size_t max_in_flight = 1'000;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::uint64_t*> in_flight;
+    std::unordered_set<void*> addresses;
+
+    std::thread producer{ [&] {
+        for (std::size_t i = 0; i < num_blocks; ++i) {
+            auto* block = static_cast<std::uint64_t*>(Pool::instance().allocate(24));
+            block[0] = i;
+            block[2] = i;
+            addresses.insert(block);
+
+            std::unique_lock lock{ mutex };
+            cv.wait(lock, [&] { return in_flight.size() < max_in_flight; });
+            in_flight.push_back(block);
+            cv.notify_all();
+        }
+    } };
+
+    std::size_t num_corrupted{ 0 };
+    std::thread consumer{ [&] {
+        for (std::size_t i = 0; i < num_blocks; ++i) {
+            std::unique_lock lock{ mutex };
+            cv.wait(lock, [&] { return !in_flight.empty(); });
+            std::uint64_t* block = in_flight.front();
+            in_flight.pop_front();
+            cv.notify_all();
+            lock.unlock();
+
+            if (block[0] != i || block[2] != i)
+                ++num_corrupted;
+            Pool::instance().deallocate(block, 24);
+        }
+    } };
+
+    producer.join();
+    consumer.join();
+    ASSERT_EQ(num_corrupted, 0);
+
+    // The 10000 blocks of the 32-byte bucket were never exhausted
+    ASSERT_LT(addresses.size(), 10'000);
+}
+
+TEST(memory_pool_tests, CachingPoolReturnsFreedBlocksToTheBucket)
+{
+    /* Blocks freed through the caches are visible to multi-block allocations */
+    using Pool = dev::CachingMemoryPool<1>;
+    const std::size_t index = Pool::size_class(512);
+    ASSERT_EQ(Pool::pool_t::block_sizes[index], 512);
+
+    // Exhaust the 512-byte bucket through this thread's magazine
+    std::vector<std::byte*> blocks;
+    for (std::size_t i = 0; i < 10'000; ++i)
+        blocks.push_back(static_cast<std::byte*>(Pool::instance().allocate(512)));
+    const auto [first, last] = std::minmax_element(blocks.begin(), blocks.end());
+    ASSERT_EQ(*last - *first, 512 * 9'999);
+    for (std::byte* block : blocks)
+        Pool::instance().deallocate(block, 512);
+
+    // 3 blocks of 512 bytes are the best fit for 1536 bytes
+    for (std::size_t i = 0; i < 100; ++i) {
+        auto* ptr = static_cast<std::byte*>(Pool::instance().allocate(1536));
+        ASSERT_GE(ptr, *first);
+        ASSERT_LE(ptr, *last);
+        blocks[i] = ptr;
+    }
+    for (std::size_t i = 0; i < 100; ++i)
+        Pool::instance().deallocate(blocks[i], 1536);
+}
+
+TEST(memory_pool_tests, CachingPoolReclaimsParkedBlocksWhenExhausted)
+{
+    /* An exhausted pool reuses the blocks parked on the remote-free lists */
+    using Pool = dev::CachingMemoryPool<1>;
+    std::latch allocated{ 1 };
+    std::latch exhausted{ 1 };
+    std::latch freed{ 1 };
+    std::latch done{ 1 };
+
+    // Another thread frees 288 blocks: 256 are parked on the remote-free
+    // list and 32 stay in its magazine while it is alive
+    std::thread parker{ [&] {
+        std::vector<void*> blocks;
+        for (std::size_t i = 0; i < 288; ++i)
+            blocks.push_back(Pool::instance().allocate(1024));
+        allocated.count_down();
+        exhausted.wait();
+        for (void* block : blocks)
+            Pool::instance().deallocate(block, 1024);
+        freed.count_down();
+        done.wait();
+    } };
+
+    allocated.wait();
+    std::vector<void*> blocks;
+    try {
+        while (true)
+            blocks.push_back(Pool::instance().allocate(4096));
+    } catch (const std::bad_alloc&) {
+    }
+    exhausted.count_down();
+    freed.wait();
+
+    void* ptr = nullptr;
+    EXPECT_NO_THROW(ptr = Pool::instance().allocate(4096));
+    if (ptr != nullptr)
+        blocks.push_back(ptr);
+    for (void* block : blocks)
+        Pool::instance().deallocate(block, 4096);
+    done.count_down();
+    parker.join();
+}
+
+TEST(memory_pool_tests, AtomicBucketPoolIsSharedByThreads)
+{
+    /* Concurrent allocations never overlap, including runs across words */
+    dev::AtomicBucket bucket{ 8, 200 };
+    void* ptr1 = bucket.allocate(8 * 60);
+    void* ptr2 = bucket.allocate(8 * 10);
+    ASSERT_EQ(static_cast<std::byte*>(ptr2) - static_cast<std::byte*>(ptr1), 8 * 60);
+    ASSERT_EQ(bucket.allocate(8 * 131), nullptr);
+    ASSERT_EQ(bucket.allocate(8 * 130), static_cast<std::byte*>(ptr2) + 8 * 10);
+    bucket.deallocate(ptr1);
+    ASSERT_EQ(bucket.allocate(8 * 61), nullptr);
+    ASSERT_EQ(bucket.allocate(8 * 60), ptr1);
+
+    static_assert(std::is_same_v<dev::MemoryPool<2>::bucket_t, dev::AtomicBucket>);
+    auto pool = std::make_unique<dev::MemoryPool<2>>();
+    std::vector<std::thread> threads;
+    std::vector<std::size_t> num_corrupted(8, 0);
+    for (unsigned char t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t] {
+            std::vector<std::pair<unsigned char*, std::size_t>> blocks;
+            for (std::size_t i = 0; i < 20'000; ++i) {
+                // Sizes up to 600 bytes, multi-block runs in the small buckets
+                const std::size_t bytes = 1 + (i * 37 + t * 11) % 600;
+                auto* ptr = static_cast<unsigned char*>(pool->allocate(bytes));
+                std::memset(ptr, t, bytes);
+                blocks.emplace_back(ptr, bytes);
+                if (blocks.size() == 64 || i % 7 == 0) {
+                    for (auto [block, size] : blocks) {
+                        for (std::size_t b = 0; b < size; ++b)
+                            num_corrupted[t] += (block[b] != t);
+                        pool->deallocate(block);
+                    }
+                    blocks.clear();
+                }
+            }
+            for (auto [block, size] : blocks)
+                pool->deallocate(block);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    for (std::size_t count : num_corrupted)
+        ASSERT_EQ(count, 0);
+}
+
 /*TEST(memory_pool_tests, Exhaustion)
 {
 dev::MemoryPool pool;
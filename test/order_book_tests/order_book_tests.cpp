@@ -1,13 +1,35 @@
+#include "command.h"
 #include "formatter.h"
+#include "journal.h"
 #include "market_data_manager.h"
+#include "mpmc_queue.h"
 #include "order.h"
 #include "order_book.h"
+#include "order_entry_decoder.h"
+#include "order_entry_protocol.h"
+#include "order_pool.h"
 #include "order_type.h"
+#include "price_ladder.h"
 #include "price_level.h"
+#include "sharded_engine.h"
+#include "symbol_directory.h"
+#include "timer_wheel.h"
 #include "trade.h"
+#include "trade_listener.h"
+#include "trade_logger.h"
+#include "trade_publisher.h"
+#include "user_registry.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
 #include <format>
 #include <gtest/gtest.h>
+#include <sstream>
 #include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 using namespace dev;
 
@@ -15,4 +37,1203 @@ TEST(order_book_tests, LimitOrder_Match_FullFill)
 {
     MarketDataManager mm;
     mm.add_order(OrderType::LIMIT, "buyer01", 'B', "MSFT", 100, 50);
-}
\ No newline at end of file
+}
+TEST(order_book_tests, PriceLadder_BestBidAndAsk)
+{
+    OrderBook order_book;
+    order_book.add_order(OrderType::LIMIT, 1, 'B', "MSFT", 100, 10);
+    order_book.add_order(OrderType::LIMIT, 2, 'B', "MSFT", 105, 10);
+    order_book.add_order(OrderType::LIMIT, 3, 'B', "MSFT", 95, 10);
+    order_book.add_order(OrderType::LIMIT, 11, 'S', "MSFT", 110, 10);
+    order_book.add_order(OrderType::LIMIT, 12, 'S', "MSFT", 108, 10);
+
+    EXPECT_EQ(order_book.get_best_bid().get_price(), 105);
+    EXPECT_EQ(order_book.get_best_ask().get_price(), 108);
+    EXPECT_EQ(order_book.get_bids().size(), 3);
+    EXPECT_EQ(order_book.get_asks().size(), 2);
+
+    order_book.cancel_order(order_book.get_best_bid().front().order_id);
+    EXPECT_EQ(order_book.get_best_bid().get_price(), 100);
+
+    order_book.cancel_order(order_book.get_best_ask().front().order_id);
+    EXPECT_EQ(order_book.get_best_ask().get_price(), 110);
+}
+
+TEST(order_book_tests, PriceLadder_SparseLevels)
+{
+    OrderBook order_book{ OrderBookConfig{
+      .base_price = 1000, .tick_size = 5, .num_ticks = 1u << 16 } };
+    order_book.add_order(OrderType::LIMIT, 1, 'B', "MSFT", 1005, 10);
+    order_book.add_order(OrderType::LIMIT, 2, 'B', "MSFT", 300000, 10);
+    order_book.add_order(OrderType::LIMIT, 11, 'S', "MSFT", 300005, 10);
+    order_book.add_order(OrderType::LIMIT, 12, 'S', "MSFT", 325000, 10);
+
+    EXPECT_EQ(order_book.get_best_bid().get_price(), 300000);
+    EXPECT_EQ(order_book.get_best_ask().get_price(), 300005);
+
+    order_book.cancel_order(order_book.get_best_bid().front().order_id);
+    order_book.cancel_order(order_book.get_best_ask().front().order_id);
+    EXPECT_EQ(order_book.get_best_bid().get_price(), 1005);
+    EXPECT_EQ(order_book.get_best_ask().get_price(), 325000);
+
+    order_book.cancel_order(order_book.get_best_bid().front().order_id);
+    EXPECT_TRUE(order_book.get_bids().empty());
+    EXPECT_THROW(order_book.get_best_bid(), std::logic_error);
+}
+
+TEST(order_book_tests, PriceLadder_LazyLevels)
+{
+    // A grid whose last block of levels is partial
+    const OrderBookConfig config{ .base_price = 100, .tick_size = 1, .num_ticks = 1000 };
+    OrderBook order_book{ config };
+    PriceLadder price_ladder{ LevelType::BID, config, order_book, true };
+    EXPECT_EQ(price_ladder.find(150), nullptr);
+
+    for (Price price : { 100, 640, 1099 })
+        price_ladder.mark_occupied(price_ladder.at(price));
+    EXPECT_EQ(price_ladder.at(1099).get_price(), 1099u);
+    EXPECT_EQ(price_ladder.find(640), &price_ladder.at(640));
+    EXPECT_EQ(price_ladder.find(641), nullptr);
+
+    EXPECT_EQ(price_ladder.best().get_price(), 1099u);
+    PriceLevel* price_level = price_ladder.next_level(price_ladder.best());
+    ASSERT_NE(price_level, nullptr);
+    EXPECT_EQ(price_level->get_price(), 640u);
+    price_ladder.mark_empty(*price_level);
+    price_ladder.mark_empty(price_ladder.best());
+    EXPECT_EQ(price_ladder.best().get_price(), 100u);
+}
+
+TEST(order_book_tests, PriceLadder_OffGridPriceThrows)
+{
+    OrderBook order_book{ OrderBookConfig{
+      .base_price = 100, .tick_size = 5, .num_ticks = 100 } };
+    EXPECT_THROW(order_book.add_order(OrderType::LIMIT, 1, 'B', "MSFT", 102, 10),
+                 std::logic_error);
+    EXPECT_THROW(order_book.add_order(OrderType::LIMIT, 1, 'B', "MSFT", 95, 10),
+                 std::logic_error);
+    EXPECT_THROW(order_book.add_order(OrderType::LIMIT, 1, 'B', "MSFT", 600, 10),
+                 std::logic_error);
+    EXPECT_TRUE(order_book.get_bids().empty());
+}
+
+namespace {
+/**
+ * @brief Test listener recording trades into a fixed-size buffer.
+ */
+struct RecordingTradeListener : TradeListener
+{
+    std::array<Trade, 16> trades{};
+    std::size_t count{ 0u };
+
+    void on_trade(const Trade& trade) override { trades[count++] = trade; }
+};
+}
+
+TEST(order_book_tests, TradeListener_ReceivesFills)
+{
+    RecordingTradeListener listener;
+    MarketDataManager mm;
+    mm.set_trade_listener(&listener);
+
+    mm.add_order(OrderType::LIMIT, "buyer01", 'B', "MSFT", 100, 50);
+    mm.add_order(OrderType::LIMIT, "seller01", 'S', "MSFT", 100, 30);
+
+    ASSERT_EQ(listener.count, 1u);
+    const Trade& trade = listener.trades[0];
+    UserRegistry& user_registry = mm.get_user_registry();
+    EXPECT_EQ(user_registry.get_user_name(trade.executing_order.user_id), "seller01");
+    EXPECT_EQ(trade.executing_order.fill_type, FillType::Full);
+    EXPECT_EQ(user_registry.get_user_name(trade.reducing_order.user_id), "buyer01");
+    EXPECT_EQ(trade.reducing_order.fill_type, FillType::Partial);
+    EXPECT_EQ(trade.reducing_order.quantity, 30u);
+
+    OrderBook& order_book = mm.get_order_book("MSFT");
+    EXPECT_TRUE(order_book.get_asks().empty());
+    EXPECT_EQ(order_book.get_best_bid().front().remaining_quantity, 20u);
+}
+
+TEST(order_book_tests, TradeListener_AggressorIsNotLiveWhileMatching)
+{
+    struct ExistenceListener : TradeListener
+    {
+        OrderBook* order_book{ nullptr };
+        bool aggressor_exists{ true };
+
+        void on_trade(const Trade& trade) override
+        {
+            aggressor_exists = order_book->order_exists(trade.reducing_order.order_id);
+        }
+    };
+
+    OrderBook order_book;
+    ExistenceListener listener;
+    listener.order_book = &order_book;
+    order_book.set_trade_listener(&listener);
+
+    // The aggressor reuses the slot of the cancelled bid, and only becomes
+    // live when its remainder rests
+    order_book.add_order(OrderType::LIMIT, 1, 'S', "MSFT", 100, 10);
+    OrderId bid_id = order_book.add_order(OrderType::LIMIT, 2, 'B', "MSFT", 90, 10);
+    order_book.cancel_order(bid_id);
+    OrderId order_id = order_book.add_order(OrderType::LIMIT, 3, 'B', "MSFT", 100, 15);
+
+    EXPECT_EQ(order_id.seq_num, bid_id.seq_num);
+    EXPECT_FALSE(listener.aggressor_exists);
+    EXPECT_EQ(order_book.get_order(order_id).remaining_quantity, 5u);
+}
+
+TEST(order_book_tests, TradeLogger_FormatsOffThread)
+{
+    std::ostringstream os;
+    {
+        MarketDataManager mm;
+        TradeLogger logger{ os, &mm.get_user_registry() };
+        mm.set_trade_listener(&logger);
+        mm.add_order(OrderType::LIMIT, "buyer01", 'B', "MSFT", 100, 10);
+        mm.add_order(OrderType::LIMIT, "seller01", 'S', "MSFT", 100, 10);
+        EXPECT_EQ(logger.get_dropped_count(), 0u);
+    }
+
+    EXPECT_NE(os.str().find("executing_order_fill_info="), std::string::npos);
+    EXPECT_NE(os.str().find("symbol=MSFT"), std::string::npos);
+    EXPECT_NE(os.str().find("user_name=seller01"), std::string::npos);
+}
+
+TEST(order_book_tests, UserRegistry_InternsHandles)
+{
+    UserRegistry user_registry{ 2 };
+    UserId buyer = user_registry.intern("buyer01");
+    UserId seller = user_registry.intern("seller01");
+
+    EXPECT_NE(buyer, seller);
+    EXPECT_EQ(user_registry.intern("buyer01"), buyer);
+    EXPECT_EQ(user_registry.find("seller01"), seller);
+    EXPECT_EQ(user_registry.find("nobody"), std::nullopt);
+    EXPECT_EQ(user_registry.get_user_name(seller), "seller01");
+    EXPECT_THROW(user_registry.intern("third"), std::logic_error);
+    EXPECT_THROW(user_registry.get_user_name(7), std::logic_error);
+
+    static_assert(std::is_trivially_copyable_v<Order>);
+    static_assert(sizeof(Order) <= 64);
+}
+
+TEST(order_book_tests, Aggressor_WalksOppositeLevels)
+{
+    RecordingTradeListener listener;
+    OrderBook order_book;
+    order_book.set_trade_listener(&listener);
+    order_book.add_order(OrderType::LIMIT, 11, 'S', "MSFT", 101, 10);
+    order_book.add_order(OrderType::LIMIT, 12, 'S', "MSFT", 102, 10);
+    order_book.add_order(OrderType::LIMIT, 13, 'S', "MSFT", 103, 10);
+
+    OrderId order_id = order_book.add_order(OrderType::LIMIT, 1, 'B', "MSFT", 102, 25);
+
+    ASSERT_EQ(listener.count, 2u);
+    EXPECT_EQ(listener.trades[0].executing_order.price, 101u);
+    EXPECT_EQ(listener.trades[1].executing_order.price, 102u);
+    EXPECT_EQ(listener.trades[1].reducing_order.order_id.seq_num, order_id.seq_num);
+    EXPECT_EQ(listener.trades[1].reducing_order.fill_type, FillType::Partial);
+
+    // Only the remainder rests
+    EXPECT_EQ(order_book.get_best_bid().get_price(), 102u);
+    EXPECT_EQ(order_book.get_order(order_id).remaining_quantity, 5u);
+    EXPECT_EQ(order_book.get_best_ask().get_price(), 103u);
+    EXPECT_EQ(order_book.get_asks().size(), 1u);
+}
+
+TEST(order_book_tests, Aggressor_ImmediateOrdersDoNotRest)
+{
+    OrderBook order_book;
+    EXPECT_EQ(order_book.add_order(OrderType::MARKET, 1, 'B', "MSFT", 0, 10).seq_num, 0u);
+    OrderId no_match_id =
+      order_book.add_order(OrderType::FILL_AND_KILL, 1, 'B', "MSFT", 100, 10);
+    EXPECT_EQ(no_match_id.seq_num, 0u);
+    EXPECT_TRUE(order_book.get_bids().empty());
+
+    order_book.add_order(OrderType::LIMIT, 11, 'S', "MSFT", 100, 10);
+    order_book.add_order(OrderType::LIMIT, 12, 'S', "MSFT", 105, 10);
+
+    OrderId fak_id =
+      order_book.add_order(OrderType::FILL_AND_KILL, 2, 'B', "MSFT", 100, 15);
+    EXPECT_NE(fak_id.seq_num, 0u);
+    EXPECT_FALSE(order_book.order_exists(fak_id));
+    EXPECT_TRUE(order_book.get_bids().empty());
+
+    OrderId market_id = order_book.add_order(OrderType::MARKET, 3, 'B', "MSFT", 0, 15);
+    EXPECT_FALSE(order_book.order_exists(market_id));
+    EXPECT_TRUE(order_book.get_bids().empty());
+    EXPECT_TRUE(order_book.get_asks().empty());
+}
+
+TEST(order_book_tests, AuctionMode_MatchUncrossesBook)
+{
+    RecordingTradeListener listener;
+    OrderBook order_book;
+    order_book.set_trade_listener(&listener);
+    order_book.set_auction_mode(true);
+    order_book.add_order(OrderType::LIMIT, 1, 'B', "MSFT", 105, 10);
+    order_book.add_order(OrderType::LIMIT, 11, 'S', "MSFT", 100, 4);
+    order_book.add_order(OrderType::LIMIT, 12, 'S', "MSFT", 104, 4);
+    EXPECT_EQ(listener.count, 0u);
+
+    order_book.match();
+    order_book.set_auction_mode(false);
+
+    EXPECT_EQ(listener.count, 2u);
+    EXPECT_TRUE(order_book.get_asks().empty());
+    EXPECT_EQ(order_book.get_best_bid().front().remaining_quantity, 2u);
+}
+
+TEST(order_book_tests, OrderPool_RejectsStaleOrderIds)
+{
+    OrderBook order_book;
+    OrderId first_id = order_book.add_order(OrderType::LIMIT, 1, 'B', "MSFT", 100, 10);
+    order_book.cancel_order(first_id);
+    EXPECT_FALSE(order_book.order_exists(first_id));
+
+    // The freed slot is reused with a new generation
+    OrderId second_id = order_book.add_order(OrderType::LIMIT, 2, 'B', "MSFT", 101, 10);
+    EXPECT_EQ(second_id.seq_num, first_id.seq_num);
+    EXPECT_NE(second_id.generation, first_id.generation);
+    EXPECT_TRUE(order_book.order_exists(second_id));
+    EXPECT_FALSE(order_book.order_exists(first_id));
+    EXPECT_THROW(order_book.get_order(first_id), std::logic_error);
+    EXPECT_THROW(order_book.cancel_order(first_id), std::logic_error);
+    EXPECT_EQ(order_book.get_order(second_id).user_id, 2u);
+}
+
+TEST(order_book_tests, OrderPool_IntrusiveFreeList)
+{
+    OrderPool order_pool{ 16 };
+    SeqNum a = order_pool.acquire();
+    SeqNum b = order_pool.acquire();
+    EXPECT_EQ(order_pool.get_live_count(), 2u);
+
+    order_pool.release(a);
+    order_pool.release(b);
+    EXPECT_EQ(order_pool.get_live_count(), 0u);
+    EXPECT_EQ(order_pool[a].prev, OrderPool::free_marker);
+
+    // Slots come back LIFO without growing the pool
+    std::size_t size = order_pool.size();
+    EXPECT_EQ(order_pool.acquire(), b);
+    EXPECT_EQ(order_pool.acquire(), a);
+    EXPECT_EQ(order_pool.size(), size);
+    OrderId order_id{ .symbol_name = "MSF",
+                      .seq_num = a,
+                      .generation = order_pool.get_generation(a) };
+    EXPECT_FALSE(order_pool.is_live(order_id));
+
+    static_assert(sizeof(OrderNode) <= 64);
+}
+
+TEST(order_book_tests, OrderPool_GrowsWithoutMovingOrders)
+{
+    OrderBook order_book{ OrderBookConfig{ .order_pool_capacity = 8 } };
+    std::size_t initial_capacity = order_book.get_order_pool().capacity();
+    EXPECT_GE(initial_capacity, 9u);
+
+    OrderId first_id = order_book.add_order(OrderType::LIMIT, 1, 'B', "MSFT", 100, 10);
+    const Order* first_order = &order_book.get_order(first_id);
+
+    for (std::size_t i{ 0 }; i < 2 * OrderPool::segment_size; ++i)
+        order_book.add_order(OrderType::LIMIT, 2, 'B', "MSFT", 99, 1);
+
+    EXPECT_GT(order_book.get_order_pool().capacity(), initial_capacity);
+    EXPECT_EQ(&order_book.get_order(first_id), first_order);
+    EXPECT_EQ(first_order->remaining_quantity, 10u);
+    EXPECT_EQ(order_book.get_order_pool().get_live_count(),
+              2 * OrderPool::segment_size + 1);
+}
+
+namespace {
+OrderRequest
+make_order_request(std::string_view symbol_name,
+                   UserId user_id,
+                   Side side,
+                   Price price,
+                   Quantity quantity)
+{
+    OrderRequest order_request{ .symbol_name = {},
+                                .user_id = user_id,
+                                .order_type = OrderType::LIMIT,
+                                .side = side,
+                                .price = price,
+                                .quantity = quantity,
+                                .stop_price = 0 };
+    std::memcpy(order_request.symbol_name, symbol_name.data(), symbol_name.size());
+    return order_request;
+}
+}
+
+TEST(order_book_tests, Batch_AddAndCancelAcrossBooks)
+{
+    MarketDataManager mm;
+    const std::array<OrderRequest, 4> order_requests{
+        make_order_request("MSFT", 1, 'B', 100, 10),
+        make_order_request("MSFT", 2, 'S', 101, 10),
+        make_order_request("AAPL", 3, 'B', 200, 10),
+        make_order_request("MSFT", 4, 'B', 102, 10),
+    };
+    std::array<CommandResult, 4> results{};
+    mm.add_orders(order_requests, results);
+
+    for (const CommandResult& result : results)
+        EXPECT_EQ(result.status, CommandStatus::ACCEPTED);
+
+    // The last buy crossed the resting ask and did not rest
+    EXPECT_FALSE(mm.get_order_book("MSFT").order_exists(results[3].order_id));
+    EXPECT_EQ(mm.get_order_book("AAPL").get_best_bid().get_price(), 200u);
+
+    const std::array<OrderId, 3> order_ids{ results[0].order_id,
+                                            results[1].order_id,
+                                            results[2].order_id };
+    std::array<CommandResult, 3> cancel_results{};
+    mm.cancel_orders(order_ids, cancel_results);
+
+    EXPECT_EQ(cancel_results[0].status, CommandStatus::ACCEPTED);
+    EXPECT_EQ(cancel_results[1].status, CommandStatus::REJECTED);
+    EXPECT_EQ(cancel_results[2].status, CommandStatus::ACCEPTED);
+    EXPECT_TRUE(mm.get_order_book("MSFT").get_bids().empty());
+    EXPECT_TRUE(mm.get_order_book("AAPL").get_bids().empty());
+}
+
+TEST(order_book_tests, Batch_MixedCommands)
+{
+    MarketDataManager mm;
+    OrderId resting_id = mm.add_order(OrderType::LIMIT, 1u, 'B', "MSFT", 100, 10);
+    OrderId unknown_id{ .symbol_name = "IBM", .seq_num = 1, .generation = 0 };
+
+    const std::array<Command, 4> commands{
+        Command{ .command_type = CommandType::MODIFY_ORDER,
+                 .order_request = {},
+                 .order_id = resting_id,
+                 .new_price = 100,
+                 .new_quantity = 5 },
+        Command{ .command_type = CommandType::ADD_ORDER,
+                 .order_request = make_order_request("MSFT", 2, 'S', 100, 3),
+                 .order_id = {},
+                 .new_price = 0,
+                 .new_quantity = 0 },
+        Command{ .command_type = CommandType::ADD_ORDER,
+                 .order_request = make_order_request("MSFT", 2, 'B', 1u << 20, 3),
+                 .order_id = {},
+                 .new_price = 0,
+                 .new_quantity = 0 },
+        Command{ .command_type = CommandType::CANCEL_ORDER,
+                 .order_request = {},
+                 .order_id = unknown_id,
+                 .new_price = 0,
+                 .new_quantity = 0 },
+    };
+    std::array<CommandResult, 4> results{};
+    mm.process_commands(commands, results);
+
+    EXPECT_EQ(results[0].status, CommandStatus::ACCEPTED);
+    EXPECT_EQ(results[1].status, CommandStatus::ACCEPTED);
+    EXPECT_EQ(results[2].status, CommandStatus::REJECTED);
+    EXPECT_EQ(results[3].status, CommandStatus::REJECTED);
+    EXPECT_EQ(mm.get_order(resting_id).remaining_quantity, 2u);
+}
+
+TEST(order_book_tests, PriceLevel_TracksAggregates)
+{
+    OrderBook order_book;
+    OrderId first_id = order_book.add_order(OrderType::LIMIT, 1u, 'S', "MSFT", 101, 10);
+    order_book.add_order(OrderType::LIMIT, 2u, 'S', "MSFT", 101, 20);
+    OrderId third_id = order_book.add_order(OrderType::LIMIT, 3u, 'S', "MSFT", 101, 30);
+
+    PriceLevel& price_level = order_book.get_ask_price_level(101);
+    EXPECT_EQ(price_level.get_total_quantity(), 60u);
+    EXPECT_EQ(price_level.get_order_count(), 3u);
+
+    // A partial fill of the head of the queue
+    order_book.add_order(OrderType::LIMIT, 4u, 'B', "MSFT", 101, 4);
+    EXPECT_EQ(price_level.get_total_quantity(), 56u);
+    EXPECT_EQ(price_level.get_order_count(), 3u);
+
+    order_book.modify_order(third_id, 101, 10);
+    EXPECT_EQ(price_level.get_total_quantity(), 36u);
+
+    order_book.cancel_order(first_id);
+    EXPECT_EQ(price_level.get_total_quantity(), 30u);
+    EXPECT_EQ(price_level.get_order_count(), 2u);
+
+    // Fills the second order and part of the third
+    order_book.add_order(OrderType::LIMIT, 4u, 'B', "MSFT", 101, 25);
+    EXPECT_EQ(price_level.get_total_quantity(), 5u);
+    EXPECT_EQ(price_level.get_order_count(), 1u);
+}
+
+TEST(order_book_tests, DepthQueries)
+{
+    OrderBook order_book;
+    order_book.add_order(OrderType::LIMIT, 1u, 'S', "MSFT", 101, 10);
+    order_book.add_order(OrderType::LIMIT, 2u, 'S', "MSFT", 101, 5);
+    order_book.add_order(OrderType::LIMIT, 3u, 'S', "MSFT", 103, 20);
+    order_book.add_order(OrderType::LIMIT, 4u, 'S', "MSFT", 110, 40);
+    order_book.add_order(OrderType::LIMIT, 5u, 'B', "MSFT", 99, 7);
+
+    std::array<DepthLevel, 2> depth_levels{};
+    ASSERT_EQ(order_book.get_depth(LevelType::ASK, depth_levels), 2u);
+    EXPECT_EQ(depth_levels[0].price, 101u);
+    EXPECT_EQ(depth_levels[0].quantity, 15u);
+    EXPECT_EQ(depth_levels[0].order_count, 2u);
+    EXPECT_EQ(depth_levels[1].price, 103u);
+    EXPECT_EQ(depth_levels[1].quantity, 20u);
+    EXPECT_EQ(order_book.get_depth(LevelType::BID, depth_levels), 1u);
+
+    EXPECT_EQ(order_book.get_cumulative_quantity(LevelType::ASK, 100), 0u);
+    EXPECT_EQ(order_book.get_cumulative_quantity(LevelType::ASK, 105), 35u);
+    EXPECT_EQ(order_book.get_cumulative_quantity(LevelType::BID, 99), 7u);
+
+    // 15 @ 101 + 5 @ 103
+    std::optional<double> average_price = order_book.get_average_fill_price('B', 20);
+    ASSERT_TRUE(average_price.has_value());
+    EXPECT_DOUBLE_EQ(*average_price, (15.0 * 101 + 5.0 * 103) / 20);
+    EXPECT_FALSE(order_book.get_average_fill_price('B', 100).has_value());
+    EXPECT_FALSE(order_book.get_average_fill_price('S', 8).has_value());
+}
+
+TEST(order_book_tests, MarketDataFeed_EmitsL2AndL3Events)
+{
+    OrderBook order_book;
+    MarketDataQueue market_data_queue;
+    order_book.set_market_data_queue(&market_data_queue);
+
+    OrderId resting_id = order_book.add_order(OrderType::LIMIT, 1u, 'S', "MSFT", 101, 10);
+    order_book.add_order(OrderType::LIMIT, 2u, 'B', "MSFT", 101, 4);
+    order_book.modify_order(resting_id, 101, 3);
+    order_book.cancel_order(resting_id);
+
+    const std::array<std::pair<MarketDataEventType, Quantity>, 8> expected{ {
+      { MarketDataEventType::ORDER_ADDED, 10 },
+      { MarketDataEventType::LEVEL_CHANGED, 10 },
+      { MarketDataEventType::ORDER_EXECUTED, 4 },
+      { MarketDataEventType::LEVEL_CHANGED, 6 },
+      { MarketDataEventType::ORDER_MODIFIED, 3 },
+      { MarketDataEventType::LEVEL_CHANGED, 3 },
+      { MarketDataEventType::ORDER_CANCELLED, 0 },
+      { MarketDataEventType::LEVEL_CHANGED, 0 },
+    } };
+
+    MarketDataEvent event{};
+    for (std::size_t i{ 0 }; i < expected.size(); ++i) {
+        ASSERT_TRUE(market_data_queue.try_pop(event));
+        EXPECT_EQ(event.seq_num, i + 1);
+        EXPECT_EQ(event.event_type, expected[i].first);
+        EXPECT_EQ(event.quantity, expected[i].second);
+        EXPECT_EQ(event.side, 'S');
+        EXPECT_EQ(event.price, 101u);
+    }
+    EXPECT_EQ(event.order_count, 0u);
+    EXPECT_FALSE(market_data_queue.try_pop(event));
+    EXPECT_EQ(order_book.get_dropped_event_count(), 0u);
+}
+
+TEST(order_book_tests, FillOrKill_AllOrNothing)
+{
+    OrderBook order_book;
+    RecordingTradeListener listener;
+    order_book.set_trade_listener(&listener);
+    order_book.add_order(OrderType::LIMIT, 1u, 'S', "MSFT", 101, 10);
+    order_book.add_order(OrderType::LIMIT, 2u, 'S', "MSFT", 102, 10);
+    order_book.add_order(OrderType::LIMIT, 3u, 'S', "MSFT", 104, 10);
+    std::size_t pool_size = order_book.get_order_pool().size();
+
+    // Only 20 is offered at or below 103: rejected without touching the book
+    OrderId rejected_id =
+      order_book.add_order(OrderType::FILL_OR_KILL, 4u, 'B', "MSFT", 103, 25);
+    EXPECT_EQ(rejected_id.seq_num, 0u);
+    EXPECT_EQ(listener.count, 0u);
+    EXPECT_EQ(order_book.get_order_pool().size(), pool_size);
+    EXPECT_EQ(order_book.get_cumulative_quantity(LevelType::ASK, 104), 30u);
+
+    OrderId filled_id =
+      order_book.add_order(OrderType::FILL_OR_KILL, 4u, 'B', "MSFT", 103, 15);
+    EXPECT_NE(filled_id.seq_num, 0u);
+    EXPECT_FALSE(order_book.order_exists(filled_id));
+    EXPECT_EQ(listener.count, 2u);
+    EXPECT_EQ(order_book.get_best_ask().get_price(), 102u);
+    EXPECT_EQ(order_book.get_best_ask().get_total_quantity(), 5u);
+    EXPECT_TRUE(order_book.get_bids().empty());
+}
+
+TEST(order_book_tests, TimerWheel_ExpiresInOrderAcrossLevels)
+{
+    TimerWheel timer_wheel{ 1000 };
+    const std::array<Timestamp, 6> expire_times{
+        1000, 1063, 1064, 5000, 1000 + (Timestamp{ 1 } << 24), Timestamp{ 1 } << 40
+    };
+    for (SeqNum i{ 0 }; i < expire_times.size(); ++i)
+        timer_wheel.schedule(
+          OrderId{ .symbol_name = {}, .seq_num = i + 1, .generation = 0 },
+          expire_times[5 - i]);
+
+    std::array<OrderId, 8> expired_ids{};
+    EXPECT_EQ(timer_wheel.collect_expired(999, expired_ids), 0u);
+
+    // Orders are handed out in expiry order, one slice at a time. Moving the
+    // next ones down a level uses up the rest of the first slice's budget
+    EXPECT_EQ(timer_wheel.collect_expired(5000, std::span(expired_ids).first(2)), 1u);
+    EXPECT_EQ(expired_ids[0].seq_num, 6u);
+    EXPECT_TRUE(timer_wheel.has_expired(5000));
+    EXPECT_EQ(timer_wheel.collect_expired(5000, expired_ids), 3u);
+    EXPECT_EQ(expired_ids[0].seq_num, 5u);
+    EXPECT_EQ(expired_ids[1].seq_num, 4u);
+    EXPECT_EQ(expired_ids[2].seq_num, 3u);
+    EXPECT_FALSE(timer_wheel.has_expired(5000));
+
+    EXPECT_EQ(timer_wheel.collect_expired(Timestamp{ 1 } << 40, expired_ids), 2u);
+    EXPECT_EQ(expired_ids[0].seq_num, 2u);
+    EXPECT_EQ(expired_ids[1].seq_num, 1u);
+    EXPECT_TRUE(timer_wheel.empty());
+}
+
+TEST(order_book_tests, TimerWheel_BoundsWorkPerCall)
+{
+    // An unseeded wheel given epoch timestamps: every entry starts in the
+    // overflow list, and the close's slot is larger than a call's budget
+    TimerWheel timer_wheel;
+    const Timestamp close_time = 1'760'000'000'000;
+    const std::size_t num_entries = 1000;
+    auto expire_time_of = [&](SeqNum i) { return close_time + (i % 3 == 0 ? 0 : i); };
+    for (SeqNum i{ 0 }; i < num_entries; ++i)
+        timer_wheel.schedule(
+          OrderId{ .symbol_name = {}, .seq_num = i + 1, .generation = 0 },
+          expire_time_of(i));
+
+    std::array<OrderId, 64> expired_ids{};
+    std::vector<Timestamp> expire_times;
+    std::size_t num_calls{ 0 };
+    while (timer_wheel.has_expired(close_time + num_entries)) {
+        uint64_t work_done = timer_wheel.get_work_done();
+        std::size_t num_expired =
+          timer_wheel.collect_expired(close_time + num_entries, expired_ids);
+        EXPECT_LE(timer_wheel.get_work_done() - work_done, expired_ids.size());
+        for (std::size_t i{ 0 }; i < num_expired; ++i)
+            expire_times.push_back(expire_time_of(expired_ids[i].seq_num - 1));
+        ++num_calls;
+    }
+
+    // Each entry leaves the overflow list once and moves down at most every level
+    EXPECT_TRUE(timer_wheel.empty());
+    EXPECT_EQ(expire_times.size(), num_entries);
+    EXPECT_TRUE(std::is_sorted(expire_times.begin(), expire_times.end()));
+    EXPECT_LE(timer_wheel.get_work_done(), num_entries * (TimerWheel::num_levels + 1));
+    EXPECT_LE(num_calls, num_entries * (TimerWheel::num_levels + 1) / 64 + 1);
+}
+
+TEST(order_book_tests, GoodForDay_ExpiresAtSessionClose)
+{
+    OrderBook order_book{ OrderBookConfig{ .session_close_time = 1000 } };
+    std::array<OrderId, 10> order_ids{};
+    for (std::size_t i{ 0 }; i < order_ids.size(); ++i)
+        order_ids[i] = order_book.add_order(
+          OrderType::GOOD_FOR_DAY, 1u, 'B', "MSFT", 100 - i, 10);
+    OrderId limit_id = order_book.add_order(OrderType::LIMIT, 2u, 'B', "MSFT", 90, 10);
+    OrderId tif_id = order_book.add_order(OrderType::LIMIT, 2u, 'S', "MSFT", 110, 10);
+    order_book.schedule_expiry(tif_id, 500);
+
+    // A filled GOOD_FOR_DAY order leaves a stale entry behind
+    order_book.add_order(OrderType::LIMIT, 3u, 'S', "MSFT", 100, 10);
+
+    EXPECT_EQ(order_book.expire_orders(999, 100), 1u);
+    EXPECT_FALSE(order_book.order_exists(tif_id));
+    EXPECT_FALSE(order_book.has_expired_orders(999));
+
+    // Bounded slices at the session close
+    EXPECT_TRUE(order_book.has_expired_orders(1000));
+    EXPECT_EQ(order_book.expire_orders(1000, 4), 3u);
+    EXPECT_EQ(order_book.expire_orders(1000, 4), 4u);
+    EXPECT_EQ(order_book.expire_orders(1000, 4), 2u);
+    EXPECT_FALSE(order_book.has_expired_orders(1000));
+
+    for (OrderId order_id : order_ids)
+        EXPECT_FALSE(order_book.order_exists(order_id));
+    EXPECT_TRUE(order_book.order_exists(limit_id));
+    EXPECT_EQ(order_book.get_best_bid().get_price(), 90u);
+}
+
+TEST(order_book_tests, MarketDataManager_ExpiresWithinBudget)
+{
+    MarketDataManager mm{ OrderBookConfig{ .session_close_time = 100 }, 8 };
+    for (Price price{ 50 }; price < 53; ++price) {
+        mm.add_order(OrderType::GOOD_FOR_DAY, 1u, 'B', "MSFT", price, 1);
+        mm.add_order(OrderType::GOOD_FOR_DAY, 1u, 'B', "AAPL", price, 1);
+    }
+
+    // Each book moves its 3 entries down the wheel, then hands them out: the
+    // budget left by the first book goes to the second
+    EXPECT_EQ(mm.expire_orders(100, 10), 4u);
+    EXPECT_TRUE(mm.get_order_book("MSFT").get_bids().empty());
+    EXPECT_EQ(mm.expire_orders(100, 10), 2u);
+    EXPECT_TRUE(mm.get_order_book("AAPL").get_bids().empty());
+    EXPECT_EQ(mm.expire_orders(100, 10), 0u);
+}
+
+TEST(order_book_tests, StopOrders_TriggerInCascade)
+{
+    OrderBook order_book;
+    for (Price price : { 101, 102, 103, 105 })
+        order_book.add_order(OrderType::LIMIT, 1u, 'S', "MSFT", price, 10);
+
+    OrderId stop_id =
+      order_book.add_stop_order(OrderType::STOP, 2u, 'B', "MSFT", 102, 0, 10);
+    OrderId stop_limit_id =
+      order_book.add_stop_order(OrderType::STOP_LIMIT, 3u, 'B', "MSFT", 103, 103, 15);
+    OrderId sell_stop_id =
+      order_book.add_stop_order(OrderType::STOP, 4u, 'S', "MSFT", 95, 0, 10);
+    EXPECT_TRUE(order_book.order_exists(stop_id));
+
+    // Trades at 101 trigger nothing, pending stops are not matched against
+    order_book.add_order(OrderType::LIMIT, 5u, 'B', "MSFT", 101, 10);
+    EXPECT_EQ(order_book.get_last_trade_price(), 101u);
+    EXPECT_EQ(order_book.get_stop_levels('B').size(), 2u);
+    EXPECT_TRUE(order_book.get_bids().empty());
+
+    // A print at 102 triggers the buy stop, whose fill at 103 triggers the
+    // stop limit, which rests its remainder at its limit
+    order_book.add_order(OrderType::LIMIT, 5u, 'B', "MSFT", 102, 5);
+    EXPECT_EQ(order_book.get_last_trade_price(), 103u);
+    EXPECT_TRUE(order_book.get_stop_levels('B').empty());
+    EXPECT_FALSE(order_book.order_exists(stop_id));
+    ASSERT_TRUE(order_book.order_exists(stop_limit_id));
+    EXPECT_EQ(order_book.get_order(stop_limit_id).order_type, OrderType::LIMIT);
+    EXPECT_EQ(order_book.get_order(stop_limit_id).remaining_quantity, 10u);
+    EXPECT_EQ(order_book.get_best_bid().get_price(), 103u);
+    EXPECT_EQ(order_book.get_best_ask().get_price(), 105u);
+
+    // The price of a STOP is not amended
+    order_book.modify_order(sell_stop_id, 97, 20);
+    EXPECT_EQ(order_book.get_order(sell_stop_id).remaining_quantity, 20u);
+    EXPECT_EQ(order_book.get_order(sell_stop_id).price,
+              order_book.get_asks().get_min_price());
+    order_book.cancel_order(sell_stop_id);
+    EXPECT_TRUE(order_book.get_stop_levels('S').empty());
+    EXPECT_THROW(order_book.add_order(OrderType::STOP, 4u, 'S', "MSFT", 95, 10),
+                 std::logic_error);
+}
+
+TEST(order_book_tests, Modify_PriorityAndRelink)
+{
+    OrderBook order_book;
+    OrderId first_id = order_book.add_order(OrderType::LIMIT, 1u, 'B', "MSFT", 100, 10);
+    OrderId second_id = order_book.add_order(OrderType::LIMIT, 2u, 'B', "MSFT", 100, 10);
+
+    // Quantity down keeps the queue position
+    order_book.modify_order(first_id, 100, 5);
+    EXPECT_EQ(order_book.get_best_bid().front().order_id.seq_num, first_id.seq_num);
+    EXPECT_EQ(order_book.get_best_bid().get_total_quantity(), 15u);
+
+    // Quantity up sends the order to the back of the queue with the same id
+    order_book.modify_order(first_id, 100, 8);
+    EXPECT_EQ(order_book.get_best_bid().front().order_id.seq_num, second_id.seq_num);
+    EXPECT_EQ(order_book.get_best_bid().back().order_id.seq_num, first_id.seq_num);
+    EXPECT_TRUE(order_book.order_exists(first_id));
+    EXPECT_EQ(order_book.get_best_bid().get_total_quantity(), 18u);
+
+    // A price change moves the node to the new level
+    order_book.modify_order(second_id, 99, 10);
+    EXPECT_TRUE(order_book.order_exists(second_id));
+    EXPECT_EQ(order_book.get_bid_price_level(99).get_order_count(), 1u);
+    EXPECT_EQ(order_book.get_bid_price_level(100).get_order_count(), 1u);
+
+    // A crossing price change trades, and only the remainder rests
+    RecordingTradeListener listener;
+    order_book.set_trade_listener(&listener);
+    order_book.add_order(OrderType::LIMIT, 3u, 'S', "MSFT", 101, 4);
+    order_book.modify_order(second_id, 101, 10);
+    EXPECT_EQ(listener.count, 1u);
+    EXPECT_EQ(listener.trades[0].reducing_order.order_id.seq_num, second_id.seq_num);
+    ASSERT_TRUE(order_book.order_exists(second_id));
+    EXPECT_EQ(order_book.get_order(second_id).remaining_quantity, 6u);
+    EXPECT_EQ(order_book.get_best_bid().get_price(), 101u);
+    EXPECT_TRUE(order_book.get_asks().empty());
+    EXPECT_EQ(order_book.get_order_pool().get_live_count(), 2u);
+}
+
+TEST(order_book_tests, SymbolDirectory_AssignsDenseIds)
+{
+    SymbolDirectory symbol_directory{ 4 };
+    EXPECT_EQ(symbol_directory.intern("MSFT"), 0u);
+    EXPECT_EQ(symbol_directory.intern("A"), 1u);
+    EXPECT_EQ(symbol_directory.intern("AA"), 2u);
+    EXPECT_EQ(symbol_directory.intern("MSFT"), 0u);
+    EXPECT_EQ(symbol_directory.find("AA"), 2u);
+    EXPECT_FALSE(symbol_directory.find("AAA").has_value());
+    EXPECT_EQ(symbol_directory.get_symbol_name(1), "A");
+    EXPECT_EQ(symbol_directory.get_symbol_name(0), "MSFT");
+
+    EXPECT_THROW(symbol_directory.intern("GOOGL"), std::logic_error);
+    EXPECT_THROW(symbol_directory.intern(""), std::logic_error);
+    symbol_directory.intern("IBM");
+    EXPECT_THROW(symbol_directory.intern("ORCL"), std::logic_error);
+    EXPECT_EQ(symbol_directory.size(), 4u);
+}
+
+TEST(order_book_tests, MarketDataManager_RoutesBySymbolId)
+{
+    MarketDataManager mm{ OrderBookConfig{}, 8 };
+    SymbolId aapl_id = mm.add_symbol("AAPL");
+    OrderId order_id = mm.add_order(OrderType::LIMIT, 1u, 'B', "MSFT", 100, 10);
+
+    SymbolId msft_id = *mm.get_symbol_directory().find(order_id.get_symbol_name());
+    EXPECT_NE(msft_id, aapl_id);
+    EXPECT_EQ(&mm.get_order_book(msft_id), &mm.get_order_book("MSFT"));
+    EXPECT_TRUE(mm.get_order_book(msft_id).order_exists(order_id));
+    EXPECT_TRUE(mm.get_order_book(aapl_id).get_bids().empty());
+    EXPECT_THROW(mm.get_order_book("IBM"), std::logic_error);
+    EXPECT_THROW(mm.add_order(OrderType::LIMIT, 1u, 'B', "GOOGL", 100, 10),
+                 std::logic_error);
+}
+
+TEST(order_book_tests, ShardedEngine_RoutesSymbolsToShards)
+{
+    ShardedEngine engine{ 3, OrderBookConfig{ .order_pool_capacity = 64 }, 16 };
+    const std::array<std::string_view, 6> symbol_names{ "A", "B", "C", "D", "E", "F" };
+
+    std::vector<Command> commands;
+    for (std::string_view symbol_name : symbol_names) {
+        commands.push_back(
+          Command{ .command_type = CommandType::ADD_ORDER,
+                   .order_request = make_order_request(symbol_name, 1, 'B', 100, 10),
+                   .order_id = {},
+                   .new_price = 0,
+                   .new_quantity = 0 });
+        commands.push_back(
+          Command{ .command_type = CommandType::ADD_ORDER,
+                   .order_request = make_order_request(symbol_name, 2, 'S', 100, 4),
+                   .order_id = {},
+                   .new_price = 0,
+                   .new_quantity = 0 });
+    }
+    OrderId unknown_id{ .symbol_name = "Z", .seq_num = 1, .generation = 0 };
+    commands.push_back(Command{ .command_type = CommandType::CANCEL_ORDER,
+                                .order_request = {},
+                                .order_id = unknown_id,
+                                .new_price = 0,
+                                .new_quantity = 0 });
+
+    engine.start(false);
+    for (const Command& command : commands)
+        ASSERT_TRUE(engine.submit(command).has_value());
+
+    std::vector<EngineResult> engine_results(commands.size());
+    std::size_t num_results{ 0 };
+    while (num_results < commands.size())
+        num_results +=
+          engine.poll_results(std::span(engine_results).subspan(num_results));
+    engine.stop();
+
+    std::sort(engine_results.begin(),
+              engine_results.end(),
+              [](const EngineResult& lhs, const EngineResult& rhs) {
+                  return lhs.request_id < rhs.request_id;
+              });
+    for (std::size_t i{ 0 }; i + 1 < commands.size(); ++i)
+        EXPECT_EQ(engine_results[i].result.status, CommandStatus::ACCEPTED);
+    EXPECT_EQ(engine_results.back().result.status, CommandStatus::REJECTED);
+
+    // Symbols are dealt round-robin and each book lives on its shard only
+    for (std::size_t i{ 0 }; i < symbol_names.size(); ++i) {
+        ASSERT_EQ(engine.get_shard_index(symbol_names[i]), i % 3);
+        OrderBook& order_book = engine.get_shard(i % 3).get_order_book(symbol_names[i]);
+        EXPECT_EQ(order_book.get_best_bid().get_total_quantity(), 6u);
+        EXPECT_THROW(engine.get_shard((i + 1) % 3).get_order_book(symbol_names[i]),
+                     std::logic_error);
+    }
+
+    // The shards resolve user ids through a single registry
+    UserId user_id = engine.get_user_registry().intern("trader01");
+    for (std::size_t i{ 0 }; i < engine.get_num_shards(); ++i) {
+        EXPECT_EQ(&engine.get_shard(i).get_user_registry(), &engine.get_user_registry());
+        EXPECT_EQ(engine.get_shard(i).get_user_registry().get_user_name(user_id),
+                  "trader01");
+    }
+}
+
+TEST(order_book_tests, MpmcQueue_ConcurrentProducersAndConsumers)
+{
+    constexpr uint64_t num_per_producer = 20000;
+    MpmcQueue<uint64_t, 256> queue;
+    std::atomic<uint64_t> sum{ 0u };
+    std::atomic<uint64_t> num_popped{ 0u };
+
+    std::vector<std::jthread> threads;
+    for (uint64_t producer{ 0 }; producer < 2; ++producer) {
+        threads.emplace_back([&queue, producer] {
+            for (uint64_t i{ 1 }; i <= num_per_producer; ++i) {
+                while (!queue.try_push(producer * num_per_producer + i))
+                    std::this_thread::yield();
+            }
+        });
+    }
+    for (int consumer{ 0 }; consumer < 2; ++consumer) {
+        threads.emplace_back([&] {
+            std::array<uint64_t, 16> values{};
+            while (num_popped.load() < 2 * num_per_producer) {
+                std::size_t count = queue.try_pop_batch(values);
+                for (std::size_t i{ 0 }; i < count; ++i)
+                    sum.fetch_add(values[i]);
+                num_popped.fetch_add(count);
+            }
+        });
+    }
+    threads.clear();
+
+    const uint64_t n = 2 * num_per_producer;
+    EXPECT_EQ(num_popped.load(), n);
+    EXPECT_EQ(sum.load(), n * (n + 1) / 2);
+    EXPECT_TRUE(queue.empty());
+}
+
+namespace {
+struct CountingTradeListener : TradeListener
+{
+    std::atomic<uint64_t> count{ 0u };
+
+    void on_trade(const Trade&) override { count.fetch_add(1u); }
+};
+}
+
+TEST(order_book_tests, TradePublisher_ForwardsFromManyThreads)
+{
+    CountingTradeListener downstream;
+    {
+        TradePublisher trade_publisher{ downstream };
+        std::vector<std::jthread> producers;
+        for (int producer{ 0 }; producer < 2; ++producer) {
+            producers.emplace_back([&trade_publisher] {
+                OrderBook order_book;
+                order_book.set_trade_listener(&trade_publisher);
+                for (int i{ 0 }; i < 100; ++i) {
+                    order_book.add_order(OrderType::LIMIT, 1u, 'S', "MSFT", 100, 1);
+                    order_book.add_order(OrderType::LIMIT, 2u, 'B', "MSFT", 100, 1);
+                }
+            });
+        }
+    }
+
+    // The destructor flushes the ring before joining
+    EXPECT_EQ(downstream.count.load(), 200u);
+}
+
+namespace {
+template<typename Message>
+void
+append_message(std::vector<std::byte>& stream, const Message& message)
+{
+    const auto* bytes = reinterpret_cast<const std::byte*>(&message);
+    stream.insert(stream.end(), bytes, bytes + sizeof(Message));
+}
+
+/**
+ * @brief Intern @a num_users users in @a mm, so that the decoder accepts user
+ * ids 0 to `num_users - 1`.
+ */
+void
+intern_users(MarketDataManager& mm, std::size_t num_users)
+{
+    for (std::size_t i{ 0 }; i < num_users; ++i)
+        mm.get_user_registry().intern(std::format("user{}", i));
+}
+}
+
+TEST(order_book_tests, OrderEntryDecoder_AppliesMessagesInPlace)
+{
+    MarketDataManager mm;
+    OrderEntryDecoder decoder{ mm };
+    intern_users(mm, 3);
+    alignas(message_alignment) std::array<std::byte, 128> buffer{};
+
+    NewOrderMessage new_order{
+        .header = make_header<NewOrderMessage>(),
+        .reserved = 0,
+        .order_request = make_order_request("MSFT", 1, 'B', 100, 10),
+    };
+    std::memcpy(buffer.data(), &new_order, sizeof(new_order));
+
+    // Nothing is applied until the whole message has arrived
+    EXPECT_EQ(decoder.decode(std::span(buffer).first(sizeof(new_order) - 1)), 0u);
+    EXPECT_EQ(decoder.decode(std::span(buffer).first(sizeof(new_order))),
+              sizeof(new_order));
+    OrderId order_id = decoder.get_last_order_id();
+    EXPECT_EQ(mm.get_order(order_id).remaining_quantity, 10u);
+
+    ModifyOrderMessage modify{ .header = make_header<ModifyOrderMessage>(),
+                               .order_id = order_id,
+                               .new_price = 100,
+                               .new_quantity = 4 };
+    CancelOrderMessage cancel{ .header = make_header<CancelOrderMessage>(),
+                               .order_id = order_id };
+    std::memcpy(buffer.data(), &modify, sizeof(modify));
+    std::memcpy(buffer.data() + sizeof(modify), &cancel, sizeof(cancel));
+    // The second cancel is rejected, the order is gone
+    std::size_t num_bytes = sizeof(modify) + sizeof(cancel);
+    std::memcpy(buffer.data() + num_bytes, &cancel, sizeof(cancel));
+    num_bytes += sizeof(cancel);
+    EXPECT_EQ(decoder.decode(std::span(buffer).first(num_bytes)), num_bytes);
+    EXPECT_FALSE(mm.get_order_book("MSFT").order_exists(order_id));
+    EXPECT_EQ(decoder.get_message_count(), 4u);
+    EXPECT_EQ(decoder.get_reject_count(), 1u);
+
+    // A corrupt header cannot be skipped
+    MessageHeader bad_header{ .length = 16,
+                              .message_type = static_cast<MessageType>(42),
+                              .reserved = 0 };
+    std::memcpy(buffer.data(), &bad_header, sizeof(bad_header));
+    EXPECT_THROW(decoder.decode(std::span(buffer).first(16)), std::logic_error);
+}
+
+TEST(order_book_tests, OrderEntryDecoder_RejectsInvalidNewOrders)
+{
+    MarketDataManager mm;
+    OrderEntryDecoder decoder{ mm };
+    intern_users(mm, 2);
+
+    NewOrderMessage valid{ .header = make_header<NewOrderMessage>(),
+                           .reserved = 0,
+                           .order_request = make_order_request("MSFT", 1, 'B', 100, 10) };
+    std::vector<NewOrderMessage> invalid(4, valid);
+    invalid[0].order_request.order_type = static_cast<OrderType>(7);
+    invalid[1].order_request.side = 'X';
+    invalid[2].order_request.quantity = 0;
+    invalid[3].order_request.user_id = 2;
+
+    std::vector<std::byte> stream;
+    for (const NewOrderMessage& message : invalid)
+        append_message(stream, message);
+    append_message(stream, valid);
+    EXPECT_EQ(decoder.decode(stream), stream.size());
+    EXPECT_EQ(decoder.get_message_count(), 5u);
+    EXPECT_EQ(decoder.get_reject_count(), 4u);
+
+    // Only the valid order rests
+    OrderBook& order_book = mm.get_order_book("MSFT");
+    EXPECT_EQ(order_book.get_bids().size(), 1u);
+    EXPECT_EQ(order_book.get_best_bid().get_total_quantity(), 10u);
+    EXPECT_TRUE(order_book.get_asks().empty());
+}
+
+TEST(order_book_tests, FdIngestor_ReadsSplitMessagesFromPipe)
+{
+    MarketDataManager mm;
+    OrderEntryDecoder decoder{ mm };
+    intern_users(mm, 3);
+
+    std::vector<std::byte> stream;
+    NewOrderMessage new_order{ .header = make_header<NewOrderMessage>(),
+                               .reserved = 0,
+                               .order_request = {} };
+    for (Price price{ 100 }; price < 110; ++price) {
+        new_order.order_request = make_order_request("MSFT", 1, 'B', price, 5);
+        append_message(stream, new_order);
+        new_order.order_request = make_order_request("MSFT", 2, 'S', 200, 5);
+        append_message(stream, new_order);
+    }
+    MassCancelMessage mass_cancel{ .header = make_header<MassCancelMessage>(),
+                                   .symbol_name = { 'M', 'S', 'F', 'T' },
+                                   .user_id = 2,
+                                   .side = 'S',
+                                   .reserved = {} };
+    append_message(stream, mass_cancel);
+
+    std::array<int, 2> fds{};
+    ASSERT_EQ(pipe(fds.data()), 0);
+    ASSERT_EQ(write(fds[1], stream.data(), stream.size()),
+              static_cast<ssize_t>(stream.size()));
+    close(fds[1]);
+
+    // 100 bytes hold two messages and the start of a third
+    FdIngestor ingestor{ fds[0], decoder, 100 };
+    ingestor.run();
+    close(fds[0]);
+
+    EXPECT_EQ(ingestor.get_byte_count(), stream.size());
+    EXPECT_EQ(decoder.get_message_count(), 21u);
+    EXPECT_EQ(decoder.get_reject_count(), 0u);
+    OrderBook& order_book = mm.get_order_book("MSFT");
+    EXPECT_EQ(order_book.get_cumulative_quantity(LevelType::BID, 100), 50u);
+    EXPECT_TRUE(order_book.get_asks().empty());
+}
+
+TEST(order_book_tests, Journal_ReplayRebuildsBooks)
+{
+    std::filesystem::path path =
+      std::filesystem::temp_directory_path() / std::format("journal_{}.bin", getpid());
+    std::filesystem::remove(path);
+    const JournalConfig journal_config{ .capacity = 1u << 16, .flush_interval = {} };
+
+    std::vector<std::byte> stream;
+    NewOrderMessage new_order{ .header = make_header<NewOrderMessage>(),
+                               .reserved = 0,
+                               .order_request = {} };
+    for (Price price{ 100 }; price < 105; ++price) {
+        new_order.order_request = make_order_request("MSFT", 1, 'B', price, 5);
+        append_message(stream, new_order);
+    }
+    // Rejected, and journaled all the same: this one creates the AAPL book
+    new_order.order_request = make_order_request("AAPL", 1, 'B', 1u << 20, 5);
+    append_message(stream, new_order);
+    new_order.order_request = make_order_request("MSFT", 2, 'S', 104, 7);
+    append_message(stream, new_order);
+    // Rejected
+    append_message(stream,
+                   CancelOrderMessage{ .header = make_header<CancelOrderMessage>(),
+                                       .order_id = OrderId{ .symbol_name = "MSF",
+                                                            .seq_num = 1,
+                                                            .generation = 0 } });
+
+    std::vector<DepthLevel> bids(8);
+    std::size_t num_bid_levels{ 0 };
+    OrderId last_order_id{};
+    {
+        MarketDataManager mm;
+        OrderEntryDecoder decoder{ mm };
+        intern_users(mm, 3);
+        Journal journal{ path.string(), journal_config };
+        decoder.set_journal(&journal);
+        decoder.decode(stream);
+        EXPECT_EQ(decoder.get_reject_count(), 2u);
+        EXPECT_EQ(journal.get_sequence_number(), 8u);
+
+        journal.flush();
+        EXPECT_EQ(journal.get_flushed_sequence_number(), 8u);
+        num_bid_levels = mm.get_order_book("MSFT").get_depth(LevelType::BID, bids);
+        last_order_id = decoder.get_last_order_id();
+        EXPECT_EQ(mm.get_symbol_directory().size(), 2u);
+    }
+
+    MarketDataManager mm;
+    OrderEntryDecoder decoder{ mm };
+    intern_users(mm, 3);
+    Journal journal{ path.string(), journal_config };
+    EXPECT_EQ(journal.get_sequence_number(), 8u);
+    EXPECT_EQ(journal.replay(decoder), 8u);
+    EXPECT_EQ(decoder.get_reject_count(), 2u);
+    EXPECT_EQ(mm.get_symbol_directory().size(), 2u);
+
+    std::vector<DepthLevel> replayed_bids(8);
+    OrderBook& order_book = mm.get_order_book("MSFT");
+    ASSERT_EQ(order_book.get_depth(LevelType::BID, replayed_bids), num_bid_levels);
+    for (std::size_t i{ 0 }; i < num_bid_levels; ++i) {
+        EXPECT_EQ(replayed_bids[i].price, bids[i].price);
+        EXPECT_EQ(replayed_bids[i].quantity, bids[i].quantity);
+    }
+    EXPECT_TRUE(order_book.order_exists(last_order_id));
+
+    // Replaying a tail only applies the messages after the given one
+    MarketDataManager tail_mm;
+    OrderEntryDecoder tail_decoder{ tail_mm };
+    intern_users(tail_mm, 3);
+    EXPECT_EQ(journal.replay(tail_decoder, 4), 4u);
+    std::filesystem::remove(path);
+}
+
+TEST(order_book_tests, Journal_ReplaysExpiryInSequence)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                 std::format("expiry_journal_{}.bin", getpid());
+    std::filesystem::remove(path);
+    const JournalConfig journal_config{ .capacity = 1u << 16, .flush_interval = {} };
+    const OrderBookConfig config{ .session_close_time = 100 };
+
+    NewOrderMessage new_order{ .header = make_header<NewOrderMessage>(),
+                               .reserved = 0,
+                               .order_request = {} };
+    new_order.order_request = make_order_request("MSFT", 1, 'B', 100, 5);
+    new_order.order_request.order_type = OrderType::GOOD_FOR_DAY;
+    std::vector<std::byte> stream;
+    append_message(stream, new_order);
+
+    OrderId gfd_id{};
+    OrderId limit_id{};
+    {
+        MarketDataManager mm{ config };
+        OrderEntryDecoder decoder{ mm };
+        intern_users(mm, 3);
+        Journal journal{ path.string(), journal_config };
+        decoder.set_journal(&journal);
+        decoder.decode(stream);
+        gfd_id = decoder.get_last_order_id();
+        EXPECT_EQ(decoder.expire_orders(100, 64), 1u);
+
+        // The new order takes the expired order's slot, then is cancelled
+        stream.clear();
+        new_order.order_request = make_order_request("MSFT", 2, 'B', 99, 5);
+        append_message(stream, new_order);
+        decoder.decode(stream);
+        limit_id = decoder.get_last_order_id();
+        stream.clear();
+        append_message(stream,
+                       CancelOrderMessage{ .header = make_header<CancelOrderMessage>(),
+                                           .order_id = limit_id });
+        decoder.decode(stream);
+        EXPECT_EQ(decoder.get_reject_count(), 0u);
+        EXPECT_EQ(journal.get_sequence_number(), 4u);
+    }
+
+    MarketDataManager mm{ config };
+    OrderEntryDecoder decoder{ mm };
+    intern_users(mm, 3);
+    Journal journal{ path.string(), journal_config };
+    EXPECT_EQ(journal.replay(decoder), 4u);
+    EXPECT_EQ(decoder.get_reject_count(), 0u);
+    OrderBook& order_book = mm.get_order_book("MSFT");
+    EXPECT_FALSE(order_book.order_exists(gfd_id));
+    EXPECT_FALSE(order_book.order_exists(limit_id));
+    EXPECT_TRUE(order_book.get_bids().empty());
+    EXPECT_FALSE(order_book.has_expired_orders(100));
+    std::filesystem::remove(path);
+}
+
+TEST(order_book_tests, Snapshot_RestoresBooksAndIds)
+{
+    std::filesystem::path path =
+      std::filesystem::temp_directory_path() / std::format("snapshot_{}.bin", getpid());
+    const OrderBookConfig config{ .order_pool_capacity = 64, .session_close_time = 500 };
+
+    MarketDataManager mm{ config, 8 };
+    mm.get_user_registry().intern("alice");
+    for (Price price{ 100 }; price < 105; ++price)
+        mm.add_order(OrderType::LIMIT, 1u, 'B', "MSFT", price, 10);
+    OrderId ask_id = mm.add_order(OrderType::LIMIT, 2u, 'S', "MSFT", 110, 10);
+    mm.add_order(OrderType::LIMIT, 2u, 'S', "MSFT", 104, 4);
+    mm.add_order(OrderType::GOOD_FOR_DAY, 3u, 'S', "AAPL", 50, 1);
+    OrderId stop_id = mm.add_stop_order(OrderType::STOP, 3u, 'S', "MSFT", 90, 0, 5);
+    mm.cancel_order(ask_id);
+    mm.save_snapshot(path.string(), 42);
+
+    MarketDataManager restored_mm{ config, 8 };
+    EXPECT_EQ(restored_mm.load_snapshot(path.string()), 42u);
+    EXPECT_EQ(restored_mm.get_user_registry().get_user_name(0), "alice");
+    EXPECT_EQ(*restored_mm.get_symbol_directory().find("AAPL"),
+              *mm.get_symbol_directory().find("AAPL"));
+
+    OrderBook& order_book = mm.get_order_book("MSFT");
+    OrderBook& restored_book = restored_mm.get_order_book("MSFT");
+    std::vector<DepthLevel> bids(8);
+    std::vector<DepthLevel> restored_bids(8);
+    ASSERT_EQ(restored_book.get_depth(LevelType::BID, restored_bids),
+              order_book.get_depth(LevelType::BID, bids));
+    EXPECT_EQ(restored_bids[0].price, 104u);
+    EXPECT_EQ(restored_bids[0].quantity, 6u);
+    EXPECT_EQ(restored_book.get_last_trade_price(), 104u);
+    EXPECT_TRUE(restored_book.order_exists(stop_id));
+    EXPECT_FALSE(restored_book.order_exists(ask_id));
+
+    // Both books evolve identically from here: same ids, same expiries
+    OrderId order_id = mm.add_order(OrderType::LIMIT, 1u, 'B', "MSFT", 99, 1);
+    OrderId restored_id = restored_mm.add_order(OrderType::LIMIT, 1u, 'B', "MSFT", 99, 1);
+    EXPECT_EQ(restored_id.seq_num, order_id.seq_num);
+    EXPECT_EQ(restored_id.generation, order_id.generation);
+    EXPECT_EQ(restored_mm.expire_orders(500, 64), 1u);
+    EXPECT_TRUE(restored_mm.get_order_book("AAPL").get_asks().empty());
+
+    MarketDataManager used_mm{ config, 8 };
+    used_mm.add_symbol("MSFT");
+    EXPECT_THROW(used_mm.load_snapshot(path.string()), std::logic_error);
+    std::filesystem::remove(path);
+}